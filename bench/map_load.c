@@ -0,0 +1,57 @@
+// Load benchmark for grid_load on a generated map.
+//   make bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/map.h"
+
+#define MAP_SIDE 2048
+#define MAP_PATH "build/bench_map_2048"
+#define RUNS 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long generate_map(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        printf("[ERROR] Could not create the bench map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    srand(42);
+    for (int row = 0; row < MAP_SIDE; row++) {
+        for (int col = 0; col < MAP_SIDE; col++) {
+            // mostly single digit tiles with a few wide ids
+            int value = (rand() % 16 == 0) ? rand() % 1000 : rand() % 10;
+            fprintf(f, col == 0 ? "%d" : " %d", value);
+        }
+        fputc('\n', f);
+    }
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+int main(void) {
+    long   size = generate_map(MAP_PATH);
+    double best = 0.0;
+    for (int i = 0; i < RUNS; i++) {
+        double start   = now_seconds();
+        Grid   grid    = grid_load(MAP_PATH);
+        double elapsed = now_seconds() - start;
+        if ((grid.rows != MAP_SIDE) || (grid.cols != MAP_SIDE)) {
+            printf("[ERROR] Bench map loaded as %zux%zu\n", grid.rows, grid.cols);
+            return EXIT_FAILURE;
+        }
+        grid_free(&grid);
+        best = (i == 0 || elapsed < best) ? elapsed : best;
+    }
+
+    printf("grid_load %dx%d: %.1f MB in %.2f ms, %.1f MB/s\n", MAP_SIDE, MAP_SIDE, size / 1e6, best * 1e3,
+           size / 1e6 / best);
+    remove(MAP_PATH);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+// Load benchmark for the medieval01 kit, every OBJ parsed from text against
+// read back from the mesh cache. CPU side only, the GPU upload is the same
+// for both.
+//   make bench
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/mesh_cache.h"
+
+#define KIT "models/medieval01/*.obj"
+#define RUNS 20
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef bool (*LoadFunction)(const char* obj_path, MeshCacheModel* model);
+
+static double bench(glob_t kit, LoadFunction load) {
+    double best = 0.0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now_seconds();
+        for (size_t i = 0; i < kit.gl_pathc; i++) {
+            MeshCacheModel model = {0};
+            if (!load(kit.gl_pathv[i], &model)) {
+                printf("[ERROR] Could not load the bench model: %s\n", kit.gl_pathv[i]);
+                exit(EXIT_FAILURE);
+            }
+            mesh_cache_model_free(&model);
+        }
+        double elapsed = now_seconds() - start;
+        best           = (run == 0 || elapsed < best) ? elapsed : best;
+    }
+    return best;
+}
+
+int main(void) {
+    glob_t kit;
+    if (glob(KIT, 0, NULL, &kit) != 0) {
+        printf("[ERROR] Could not find the bench models: %s\n", KIT);
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < kit.gl_pathc; i++) {
+        MeshCacheModel model = {0};
+        if (!mesh_cache_read(kit.gl_pathv[i], &model) && !mesh_cache_cook(kit.gl_pathv[i], &model)) {
+            printf("[ERROR] Could not cook the bench model: %s\n", kit.gl_pathv[i]);
+            return EXIT_FAILURE;
+        }
+        mesh_cache_model_free(&model);
+    }
+
+    double parse = bench(kit, mesh_cache_parse);
+    double read  = bench(kit, mesh_cache_read);
+    printf("mesh load %zu models, obj parse: %.2f ms, cache read: %.2f ms (%.1fx)\n", kit.gl_pathc, parse * 1e3,
+           read * 1e3, parse / read);
+    globfree(&kit);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+// Draw benchmark for emotional text, the raylon.c message paragraph drawn
+// RUNS times with the per glyph path it replaced, the quads batched through
+// rlgl and the quads uploaded once and animated by shader/emotional_text.vs.
+// Needs a display, the window stays hidden.
+//   make bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/emotional_text.h"
+
+#define RUNS 1000
+#define FONT_PATH "fonts/alagard.ttf"
+#define FONT_SIZE 20
+
+static const char* MESSAGE = "**Life** isn't just about passing on your genes. \n"
+                             "We can leave behind much more than just DNA. \n"
+                             "Through speech, music, literature and movies... \n"
+                             "what we've seen, heard, felt anger, joy and sorrow, \n"
+                             "these are the things I will pass on. \n"
+                             "~That's what I live for. ~\n"
+                             "We need to pass the torch, and let our \n"
+                             "children read our messy and sad history by its light. \n"
+                             "We have the magic of the digital age to do that \n"
+                             "with. The human race will probably come to an end \n"
+                             "some time, and new species may rule over this \n"
+                             "planet. Earth may not be forever, but we still have \n"
+                             "the responsibility to leave what trace of life we \n"
+                             "can. Building the future and keeping the past alive \n"
+                             "are one in the same thing.";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the per glyph DrawTextCodepoint path, with the markup already compiled
+static void draw_per_glyph(const EmotionalText* compiled, Vector2 position, float time, Color color) {
+    float size = compiled->fontSize;
+    for (int r = 0; r < compiled->runCount; r++) {
+        EmotionalRun run  = compiled->runs[r];
+        Font         font = compiled->fonts[run.style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)];
+        for (int g = run.first; g < run.first + run.count; g++) {
+            EmotionalGlyph glyph = compiled->glyphs[g];
+            float          x     = position.x + glyph.offset.x;
+            float          y     = position.y + glyph.offset.y;
+            if (run.style & EMOTIONAL_WAVE) {
+                x += sin(time * EMOTIONAL_WAVE_X_SPEED - glyph.source * EMOTIONAL_WAVE_X_OFFSET) * EMOTIONAL_WAVE_X_RANGE;
+                y += sin(time * EMOTIONAL_WAVE_Y_SPEED - glyph.source * EMOTIONAL_WAVE_Y_OFFSET) * EMOTIONAL_WAVE_Y_RANGE;
+            }
+            DrawTextCodepoint(font, glyph.codepoint, (Vector2){x, y}, size, color);
+            if (run.style & EMOTIONAL_CROSSED) {
+                DrawLine(x, y + size / 2, x + glyph.advance, y + size / 2, color);
+            }
+            if (run.style & EMOTIONAL_UNDERLINE) {
+                DrawLine(x, y + size, x + glyph.advance, y + size, color);
+            }
+        }
+    }
+}
+
+typedef enum {
+    DRAW_PER_GLYPH,
+    DRAW_BATCHED,
+    DRAW_SHADER,
+    DRAW_MODES,
+} DrawMode;
+
+const char* DRAW_MODE_NAMES[DRAW_MODES] = {"per glyph", "batched", "shader"};
+
+static double bench(EmotionalText* compiled, RenderTexture2D target, DrawMode mode) {
+    BeginTextureMode(target);
+    ClearBackground(BLANK);
+    double start = now_seconds();
+    for (int i = 0; i < RUNS; i++) {
+        Vector2 position = {(float)(i % 16), (float)(i % 9)};
+        if (mode == DRAW_PER_GLYPH) {
+            draw_per_glyph(compiled, position, i * 0.01f, WHITE);
+        } else {
+            DrawEmotionalTextCompiled(compiled, position, i * 0.01f, WHITE);
+        }
+    }
+    rlDrawRenderBatchActive();
+    double elapsed = now_seconds() - start;
+    EndTextureMode();
+    return elapsed;
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(640, 360, "bench text draw");
+    if (!IsWindowReady()) {
+        printf("[ERROR] Could not open a window for the text bench\n");
+        return EXIT_FAILURE;
+    }
+
+    Font            font     = LoadFontEx(FONT_PATH, FONT_SIZE, NULL, 0);
+    Shader          shader   = LoadShader("shader/emotional_text.vs", NULL);
+    RenderTexture2D target   = LoadRenderTexture(1280, 720);
+    EmotionalText*  compiled = CompileEmotionalText(font, font, font, font, MESSAGE, FONT_SIZE, 1, 1);
+    long            glyphs   = (long)compiled->glyphCount * RUNS;
+
+    for (int mode = 0; mode < DRAW_MODES; mode++) {
+        if (mode == DRAW_SHADER) {
+            SetEmotionalTextShader(shader);
+        }
+        // the first run warms up the driver
+        bench(compiled, target, mode);
+        double elapsed = bench(compiled, target, mode);
+        printf("emotional text %d glyphs x %d, %-9s: %.2f ms, %.0f glyphs/ms\n", compiled->glyphCount, RUNS,
+               DRAW_MODE_NAMES[mode], elapsed * 1e3, glyphs / (elapsed * 1e3));
+    }
+
+    UnloadEmotionalTextCache();
+    UnloadRenderTexture(target);
+    UnloadShader(shader);
+    UnloadFont(font);
+    CloseWindow();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+// Wrap benchmark for EmotionalFlow on the raylon.c message repeated to a few
+// kilobytes: a full layout, wrapping the measured words at a new width and
+// appending the text word by word. The font is rasterized without a window.
+//   make bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/emotional_text.h"
+
+#define RUNS 200
+#define REPEATS 8
+#define FONT_PATH "fonts/alagard.ttf"
+#define FONT_SIZE 20
+#define FONT_GLYPHS 95
+#define WIDTH 560.0f
+
+static const char* MESSAGE = "**Life** isn't just about passing on your genes. "
+                             "We can leave behind much more than just DNA. "
+                             "Through speech, music, literature and movies... "
+                             "what we've seen, heard, felt anger, joy and sorrow, "
+                             "these are the things I will pass on.\n"
+                             "~That's what I live for.~\n"
+                             "We need to pass the torch, and let our "
+                             "children read our messy and sad history by its light. "
+                             "We have the magic of the digital age to do that "
+                             "with. The human race will probably come to an end "
+                             "some time, and new species may rule over this "
+                             "planet. Earth may not be forever, but we still have "
+                             "the responsibility to leave what trace of life we "
+                             "can. Building the future and keeping the past alive "
+                             "are one in the same thing.\n";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// glyph metrics only, the atlas never reaches the GPU
+static Font load_font(void) {
+    int            size = 0;
+    unsigned char* data = LoadFileData(FONT_PATH, &size);
+    if (!data) {
+        printf("[ERROR] Could not load the bench font: %s\n", FONT_PATH);
+        exit(EXIT_FAILURE);
+    }
+    Font font         = {0};
+    font.baseSize     = FONT_SIZE;
+    font.glyphCount   = FONT_GLYPHS;
+    font.glyphPadding = 4;
+    font.glyphs       = LoadFontData(data, size, FONT_SIZE, NULL, FONT_GLYPHS, FONT_DEFAULT);
+    Image atlas       = GenImageFontAtlas(font.glyphs, &font.recs, FONT_GLYPHS, FONT_SIZE, 4, 0);
+    UnloadImage(atlas);
+    UnloadFileData(data);
+    return font;
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    Font  font   = load_font();
+    int   length = TextLength(MESSAGE);
+    char* text   = (char*)malloc(length * REPEATS + 1);
+    for (int i = 0; i < REPEATS; i++) {
+        memcpy(text + i * length, MESSAGE, length + 1);
+    }
+    length *= REPEATS;
+
+    double start = now_seconds();
+    for (int i = 0; i < RUNS; i++) {
+        EmotionalFlow flow = LoadEmotionalFlow(font, font, font, font, FONT_SIZE, 1, 1, WIDTH);
+        AppendEmotionalFlow(&flow, text);
+        UnloadEmotionalFlow(&flow);
+    }
+    double layout = (now_seconds() - start) / RUNS;
+
+    EmotionalFlow flow = LoadEmotionalFlow(font, font, font, font, FONT_SIZE, 1, 1, WIDTH);
+    AppendEmotionalFlow(&flow, text);
+    start = now_seconds();
+    for (int i = 0; i < RUNS; i++) {
+        SetEmotionalFlowWidth(&flow, (i % 2) ? WIDTH : WIDTH / 2);
+    }
+    double resize = (now_seconds() - start) / RUNS;
+    int    words  = flow.wordCount;
+    UnloadEmotionalFlow(&flow);
+
+    // the text cut after every space, as a dialogue streamed in
+    char* word  = (char*)malloc(length + 1);
+    flow        = LoadEmotionalFlow(font, font, font, font, FONT_SIZE, 1, 1, WIDTH);
+    int appends = 0;
+    start       = now_seconds();
+    for (int i = 0, first = 0; i < length; i++) {
+        if ((text[i] == ' ') || (i == length - 1)) {
+            memcpy(word, text + first, i + 1 - first);
+            word[i + 1 - first] = '\0';
+            AppendEmotionalFlow(&flow, word);
+            first = i + 1;
+            appends++;
+        }
+    }
+    double append = (now_seconds() - start) / appends;
+    int    lines  = flow.lineCount;
+    UnloadEmotionalFlow(&flow);
+
+    printf("emotional flow %d bytes, %d words, %d lines at %.0f px\n", length, words, lines, WIDTH);
+    printf("  full layout: %.1f us\n", layout * 1e6);
+    printf("  new width  : %.1f us\n", resize * 1e6);
+    printf("  append word: %.2f us\n", append * 1e6);
+
+    free(word);
+    free(text);
+    UnloadFontData(font.glyphs, font.glyphCount);
+    free(font.recs);
+    return EXIT_SUCCESS;
+}
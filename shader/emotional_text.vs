@@ -0,0 +1,42 @@
+#version 330
+
+// Input vertex attributes
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec4 vertexColor;
+
+// Per glyph byte offset in the text and style bits, see emotional_text.h
+in vec2 vertexGlyph;
+
+// Input uniform values
+uniform mat4 mvp;
+uniform float time;
+
+// Output vertex attributes (to fragment shader)
+out vec2 fragTexCoord;
+out vec4 fragColor;
+out float fragStyle;
+
+// EMOTIONAL_WAVE and the EMOTIONAL_WAVE_* parameters
+const int styleWave = 4;
+const vec2 waveRange = vec2(1.0, 2.0);
+const vec2 waveSpeed = vec2(4.0, 4.0);
+const vec2 waveOffset = vec2(0.5, 0.5);
+
+void main()
+{
+    vec3 position = vertexPosition;
+    int style = int(vertexGlyph.y);
+    if ((style & styleWave) != 0)
+    {
+        position.xy += sin(time*waveSpeed - vertexGlyph.x*waveOffset)*waveRange;
+    }
+
+    // Send vertex attributes to fragment shader
+    fragTexCoord = vertexTexCoord;
+    fragColor = vertexColor;
+    fragStyle = vertexGlyph.y;
+
+    // Calculate final vertex position
+    gl_Position = mvp*vec4(position, 1.0);
+}
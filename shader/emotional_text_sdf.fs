@@ -0,0 +1,46 @@
+#version 330
+
+// Input vertex attributes (from vertex shader)
+in vec2 fragTexCoord;
+in vec4 fragColor;
+in float fragStyle;
+
+// Input uniform values
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform float outlineSize;
+uniform vec4 outlineColor;
+
+// Output fragment color
+out vec4 finalColor;
+
+// EMOTIONAL_BOLD, and how far it moves the glyph edge in distance units
+const int styleBold = 2;
+const float boldWeight = 0.08;
+
+// EMOTIONAL_OUTLINE, drawn outlineSize out of the glyph edge
+const int styleOutline = 32;
+
+void main()
+{
+    // The atlas alpha is the distance to the glyph edge, 0.5 on the edge
+    float dist = texture(texture0, fragTexCoord).a;
+    int style = int(fragStyle + 0.5);
+    float edge = 0.5;
+    if ((style & styleBold) != 0) edge -= boldWeight;
+
+    // Antialias over one screen pixel, whatever the drawn size
+    float smoothing = length(vec2(dFdx(dist), dFdy(dist)));
+    float fill = smoothstep(edge - smoothing, edge + smoothing, dist);
+    float outline = smoothstep(edge - outlineSize - smoothing, edge - outlineSize + smoothing, dist);
+
+    vec4 color = colDiffuse*fragColor;
+    if (((style & styleOutline) != 0) && (outlineSize > 0.0))
+    {
+        // Outline colour out to the outline edge, the text colour inside the glyph
+        vec4 border = vec4(outlineColor.rgb, outlineColor.a*color.a);
+        color = mix(border, color, fill);
+        finalColor = vec4(color.rgb, color.a*outline);
+    }
+    else finalColor = vec4(color.rgb, color.a*fill);
+}
@@ -0,0 +1,41 @@
+#version 330
+
+// Input vertex attributes, in the MeshQuantVertex layout of src/mesh_quant.h
+in vec3 vertexPosition;  // fixed point steps, matModel scales them back
+in vec2 vertexTexCoord;  // half floats
+in vec2 vertexNormal;    // octahedral, snorm
+in vec4 vertexColor;
+
+// Input uniform values
+uniform mat4 mvp;
+uniform mat4 matModel;
+uniform mat4 matNormal;
+
+// Output vertex attributes (to fragment shader)
+out vec3 fragPosition;
+out vec2 fragTexCoord;
+out vec4 fragColor;
+out vec3 fragNormal;
+
+// Unfolds the lower half of the octahedron folded over the xy square
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    // Send vertex attributes to fragment shader
+    fragPosition = vec3(matModel*vec4(vertexPosition, 1.0));
+    fragTexCoord = vertexTexCoord;
+    fragColor = vertexColor;
+    // the position scale of matModel is uniform, normalizing drops it
+    fragNormal = normalize(vec3(matNormal*vec4(octahedralDecode(vertexNormal), 0.0)));
+
+    // Calculate final vertex position
+    gl_Position = mvp*vec4(vertexPosition, 1.0);
+}
@@ -0,0 +1,273 @@
+#include "assets.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MATERIAL_MAPS 12 // MAX_MATERIAL_MAPS of raylib 5.0, allocated by LoadMaterialDefault
+
+typedef struct {
+    AssetsProgress progress;
+    void* user;
+    int pass;
+} AssetsPass;
+
+Assets* assets_new(void) {
+    return (Assets*)calloc(1, sizeof(Assets));
+}
+
+static Asset* asset_at(Assets* assets, int handle) {
+    if ((handle < 0) || (handle >= assets->count) || !assets->entries[handle]) {
+        printf("[ERROR] Invalid asset handle: %d\n", handle);
+        exit(EXIT_FAILURE);
+    }
+    return assets->entries[handle];
+}
+
+// one more reference on the entry, or ASSETS_NONE when there is none yet
+static int asset_find(Assets* assets, AssetKind kind, const char* path, int base) {
+    assets->requests++;
+    for (int i = 0; i < assets->count; i++) {
+        Asset* asset = assets->entries[i];
+        if (asset && (asset->kind == kind) && (asset->base == base) && (strcmp(asset->path, path) == 0)) {
+            asset->refs++;
+            return i;
+        }
+    }
+    return ASSETS_NONE;
+}
+
+static int asset_add(Assets* assets, AssetKind kind, const char* path, int base) {
+    if (strlen(path) >= MESH_CACHE_PATH_MAX) {
+        printf("[ERROR] Asset path too long, max: %d: %s\n", MESH_CACHE_PATH_MAX - 1, path);
+        exit(EXIT_FAILURE);
+    }
+    if (assets->count >= assets->capacity) {
+        assets->capacity = assets->capacity ? assets->capacity * 2 : ASSETS_INITIAL_CAPACITY;
+        assets->entries  = (Asset**)realloc(assets->entries, assets->capacity * sizeof(Asset*));
+    }
+    Asset* asset = (Asset*)calloc(1, sizeof(Asset));
+    asset->kind  = kind;
+    asset->refs  = 1;
+    asset->base  = base;
+    asset->skin  = ASSETS_NONE;
+    strcpy(asset->path, path);
+    assets->entries[assets->count] = asset;
+    return assets->count++;
+}
+
+// Queued for the next assets_load when not loaded yet
+int assets_texture(Assets* assets, const char* path) {
+    int handle = asset_find(assets, ASSET_TEXTURE, path, ASSETS_NONE);
+    return handle != ASSETS_NONE ? handle : asset_add(assets, ASSET_TEXTURE, path, ASSETS_NONE);
+}
+
+// Queued for the next assets_load when not loaded yet, with its textures
+int assets_model(Assets* assets, const char* obj_path) {
+    int handle = asset_find(assets, ASSET_MODEL, obj_path, ASSETS_NONE);
+    return handle != ASSETS_NONE ? handle : asset_add(assets, ASSET_MODEL, obj_path, ASSETS_NONE);
+}
+
+// The meshes of model drawn with texture_path on every material
+int assets_model_retextured(Assets* assets, int model, const char* texture_path) {
+    if (asset_at(assets, model)->kind != ASSET_MODEL) {
+        printf("[ERROR] Asset %d is not a model: %s\n", model, assets->entries[model]->path);
+        exit(EXIT_FAILURE);
+    }
+    int handle = asset_find(assets, ASSET_MODEL, texture_path, model);
+    if (handle != ASSETS_NONE) {
+        return handle;
+    }
+    assets_acquire(assets, model);
+    int skin                      = assets_texture(assets, texture_path);
+    handle                        = asset_add(assets, ASSET_MODEL, texture_path, model);
+    assets->entries[handle]->skin = skin;
+    return handle;
+}
+
+int assets_acquire(Assets* assets, int handle) {
+    asset_at(assets, handle)->refs++;
+    return handle;
+}
+
+static void assets_progress(int loaded, int total, void* user) {
+    AssetsPass* state = (AssetsPass*)user;
+    if (state->progress) {
+        state->progress(state->pass, loaded, total, state->user);
+    }
+}
+
+// The texture paths go through the registry, mesh_cache_upload loads none
+static void asset_request_textures(Assets* assets, Asset* asset) {
+    asset->texture_count = asset->cpu.material_count > 0 ? asset->cpu.material_count : 1;
+    asset->textures      = (int*)malloc(asset->texture_count * sizeof(int));
+    for (int i = 0; i < asset->texture_count; i++) {
+        asset->textures[i] = ASSETS_NONE;
+    }
+    for (int i = 0; i < asset->cpu.material_count; i++) {
+        if (asset->cpu.materials[i].texture[0]) {
+            asset->textures[i] = assets_texture(assets, asset->cpu.materials[i].texture);
+            asset->cpu.materials[i].texture[0] = '\0';
+        }
+    }
+}
+
+static void asset_build_model(Assets* assets, Asset* asset) {
+    if (asset->base == ASSETS_NONE) {
+        asset->model = mesh_cache_upload(&asset->cpu);
+        for (int i = 0; i < asset->texture_count; i++) {
+            if (asset->textures[i] != ASSETS_NONE) {
+                asset->model.materials[i].maps[MATERIAL_MAP_DIFFUSE].texture = asset_at(assets, asset->textures[i])->texture;
+            }
+        }
+        return;
+    }
+
+    // meshes borrowed, materials copied with their own maps
+    Model base             = asset_at(assets, asset->base)->model;
+    asset->model           = base;
+    asset->model.materials = (Material*)malloc(base.materialCount * sizeof(Material));
+    for (int i = 0; i < base.materialCount; i++) {
+        asset->model.materials[i]      = base.materials[i];
+        asset->model.materials[i].maps = (MaterialMap*)malloc(MATERIAL_MAPS * sizeof(MaterialMap));
+        memcpy(asset->model.materials[i].maps, base.materials[i].maps, MATERIAL_MAPS * sizeof(MaterialMap));
+        asset->model.materials[i].maps[MATERIAL_MAP_DIFFUSE].texture = asset_at(assets, asset->skin)->texture;
+    }
+}
+
+// Loads everything queued since the last call. The decoding runs on loader,
+// which may hold other files, then on new loaders for the textures the
+// models turned out to use, each one a pass of progress. loader is run but
+// not freed.
+void assets_load(Assets* assets, Loader* loader, AssetsProgress progress, void* user) {
+    AssetsPass state = {progress, user, 0};
+    for (;;) {
+        Loader* pass = loader ? loader : loader_new();
+        int     jobs = 0;
+        for (int i = 0; i < assets->count; i++) {
+            Asset* asset = assets->entries[i];
+            if (!asset || asset->queued || asset->loaded || (asset->base != ASSETS_NONE)) {
+                continue;
+            }
+            if (asset->kind == ASSET_TEXTURE) {
+                loader_add_texture(pass, &asset->texture, asset->path);
+            } else {
+                loader_add_meshes(pass, &asset->cpu, asset->path);
+            }
+            asset->queued = true;
+            jobs++;
+        }
+        if ((jobs == 0) && !loader) {
+            loader_free(pass);
+            break;
+        }
+
+        loader_run(pass, assets_progress, &state);
+        state.pass++;
+        if (loader) {
+            loader = NULL;
+        } else {
+            loader_free(pass);
+        }
+
+        // models ask for their textures, loaded on the next pass
+        int count = assets->count;
+        for (int i = 0; i < count; i++) {
+            Asset* asset = assets->entries[i];
+            if (!asset || !asset->queued || asset->loaded) {
+                continue;
+            }
+            if (asset->kind == ASSET_TEXTURE) {
+                asset->loaded = true;
+            } else if (!asset->textures) {
+                asset_request_textures(assets, asset);
+            }
+        }
+    }
+
+    // bases come before their retextured models
+    int textures = 0;
+    int models   = 0;
+    for (int i = 0; i < assets->count; i++) {
+        Asset* asset = assets->entries[i];
+        if (!asset) {
+            continue;
+        }
+        textures += asset->kind == ASSET_TEXTURE;
+        models += asset->kind == ASSET_MODEL;
+        if (!asset->loaded && (asset->kind == ASSET_MODEL)) {
+            asset_build_model(assets, asset);
+            asset->loaded = true;
+        }
+    }
+    printf("[INFO] Assets: %d textures, %d models for %d requests\n", textures, models, assets->requests);
+}
+
+Texture2D assets_get_texture(Assets* assets, int handle) {
+    return asset_at(assets, handle)->texture;
+}
+
+// stays at the same address until released
+Model* assets_get_model(Assets* assets, int handle) {
+    return &asset_at(assets, handle)->model;
+}
+
+// dependencies are released too unless the whole registry goes
+static void asset_unload(Assets* assets, Asset* asset, bool dependencies) {
+    if (asset->kind == ASSET_TEXTURE) {
+        if (asset->loaded) {
+            UnloadTexture(asset->texture);
+        }
+        return;
+    }
+
+    if (asset->loaded) {
+        // like UnloadModel, the textures are assets of their own
+        if (asset->base == ASSETS_NONE) {
+            for (int m = 0; m < asset->model.meshCount; m++) {
+                UnloadMesh(asset->model.meshes[m]);
+            }
+            free(asset->model.meshes);
+            free(asset->model.meshMaterial);
+        }
+        for (int i = 0; i < asset->model.materialCount; i++) {
+            free(asset->model.materials[i].maps);
+        }
+        free(asset->model.materials);
+    } else {
+        mesh_cache_model_free(&asset->cpu);
+    }
+    for (int i = 0; dependencies && (i < asset->texture_count); i++) {
+        if (asset->textures[i] != ASSETS_NONE) {
+            assets_release(assets, asset->textures[i]);
+        }
+    }
+    if (dependencies && (asset->skin != ASSETS_NONE)) {
+        assets_release(assets, asset->skin);
+    }
+    if (dependencies && (asset->base != ASSETS_NONE)) {
+        assets_release(assets, asset->base);
+    }
+    free(asset->textures);
+}
+
+// The last release unloads the asset and releases what it holds
+void assets_release(Assets* assets, int handle) {
+    Asset* asset = asset_at(assets, handle);
+    if (--asset->refs > 0) {
+        return;
+    }
+    assets->entries[handle] = NULL;
+    asset_unload(assets, asset, true);
+    free(asset);
+}
+
+// Unloads every asset left, released or not
+void assets_free(Assets* assets) {
+    for (int i = assets->count - 1; i >= 0; i--) {
+        if (assets->entries[i]) {
+            asset_unload(assets, assets->entries[i], false);
+            free(assets->entries[i]);
+        }
+    }
+    free(assets->entries);
+    free(assets);
+}
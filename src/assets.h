@@ -0,0 +1,60 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "loader.h"
+#include "mesh_cache.h"
+
+#define ASSETS_INITIAL_CAPACITY 32
+#define ASSETS_NONE -1
+
+typedef struct Asset Asset;
+typedef struct Assets Assets;
+
+typedef enum {
+    ASSET_TEXTURE,
+    ASSET_MODEL,
+} AssetKind;
+
+// One loaded file, or a retextured copy of a model. Models hold a reference
+// on the textures of their materials, retextured ones on their skin and on
+// their base model: its meshes are shared, only the materials are their own.
+struct Asset {
+    AssetKind kind;
+    char path[MESH_CACHE_PATH_MAX]; // texture or OBJ, the texture for retextured models
+    int refs;
+    bool queued; // on a loader
+    bool loaded;
+    Texture2D texture;
+    Model model;
+    int base;      // model sharing its meshes, ASSETS_NONE when loaded from path
+    int skin;      // texture of every material of a retextured model
+    int* textures; // handles by material, ASSETS_NONE without texture
+    int texture_count;
+    MeshCacheModel cpu; // decoded by the loader, until uploaded
+};
+
+// Handles are indices that stay valid until their last release, each file is
+// loaded once however many times it is asked for.
+struct Assets {
+    Asset** entries;
+    int count;
+    int capacity;
+    int requests; // every assets_texture and assets_model, the loads saved
+};
+
+// Files loaded and queued on the current pass of assets_load. Pass 0 holds
+// everything queued before the call, the later ones the textures the models
+// turned out to use, only known once they are decoded.
+typedef void (*AssetsProgress)(int pass, int loaded, int total, void* user);
+
+Assets* assets_new(void);
+int assets_texture(Assets* assets, const char* path);
+int assets_model(Assets* assets, const char* obj_path);
+int assets_model_retextured(Assets* assets, int model, const char* texture_path);
+int assets_acquire(Assets* assets, int handle);
+void assets_load(Assets* assets, Loader* loader, AssetsProgress progress, void* user);
+Texture2D assets_get_texture(Assets* assets, int handle);
+Model* assets_get_model(Assets* assets, int handle);
+void assets_release(Assets* assets, int handle);
+void assets_free(Assets* assets);
@@ -0,0 +1,308 @@
+#include "bake.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mesh_opt.h"
+#include "mesh_quant.h"
+#include "raymath.h"
+#include "rlgl.h"
+
+#define BAKE_EPSILON 0.001f
+#define BUFFER_INITIAL_CAPACITY 256
+
+// unpacks the quantized vertices, see bake_set_shader
+static Shader quantized_shader = {0};
+
+typedef struct {
+    Material material;
+    float* vertices;
+    float* texcoords;
+    float* normals;
+    int count;
+    int capacity;
+} BakeBuffer;
+
+// the four horizontal neighbours, x walks the rows and z the cols
+static const struct {
+    int row;
+    int col;
+} NEIGHBOURS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+static bool material_equal(Material a, Material b) {
+    if (a.shader.id != b.shader.id) {
+        return false;
+    }
+    return a.maps[MATERIAL_MAP_DIFFUSE].texture.id == b.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+}
+
+static BakeBuffer* bake_buffer(BakeBuffer* buffers, int* count, Material material) {
+    for (int i = 0; i < *count; i++) {
+        if (material_equal(buffers[i].material, material)) {
+            return &buffers[i];
+        }
+    }
+    if (*count >= BAKE_MATERIALS_MAX) {
+        printf("[ERROR] Too many materials in a chunk, max: %d\n", BAKE_MATERIALS_MAX);
+        exit(EXIT_FAILURE);
+    }
+    BakeBuffer* buffer = &buffers[(*count)++];
+    *buffer            = (BakeBuffer){0};
+    buffer->material   = material;
+    return buffer;
+}
+
+static void bake_buffer_push(BakeBuffer* buffer, Vector3 position, Vector2 texcoord, Vector3 normal) {
+    if (buffer->count >= buffer->capacity) {
+        buffer->capacity  = buffer->capacity ? buffer->capacity * 2 : BUFFER_INITIAL_CAPACITY;
+        buffer->vertices  = (float*)realloc(buffer->vertices, buffer->capacity * 3 * sizeof(float));
+        buffer->texcoords = (float*)realloc(buffer->texcoords, buffer->capacity * 2 * sizeof(float));
+        buffer->normals   = (float*)realloc(buffer->normals, buffer->capacity * 3 * sizeof(float));
+    }
+    int i = buffer->count++;
+    buffer->vertices[i * 3 + 0]  = position.x;
+    buffer->vertices[i * 3 + 1]  = position.y;
+    buffer->vertices[i * 3 + 2]  = position.z;
+    buffer->texcoords[i * 2 + 0] = texcoord.x;
+    buffer->texcoords[i * 2 + 1] = texcoord.y;
+    buffer->normals[i * 3 + 0]   = normal.x;
+    buffer->normals[i * 3 + 1]   = normal.y;
+    buffer->normals[i * 3 + 2]   = normal.z;
+}
+
+// A face is buried when it lies flat on a side of its cell, faces out of it
+// and the neighbour on that side is solid, covering it completely.
+// row and col index the grid, world_row and world_col place the cell in the world.
+static bool face_hidden(Grid grid, TileRenderer* tiles, size_t row, size_t col, size_t world_row, size_t world_col,
+                        Vector3 p[3], Vector3 normal) {
+    float half = TILE_SIZE / 2.0f;
+    for (int i = 0; i < 3; i++) {
+        if ((p[i].y < -BAKE_EPSILON) || (p[i].y > TILE_SIZE + BAKE_EPSILON)) {
+            return false;
+        }
+    }
+
+    for (int d = 0; d < 4; d++) {
+        int   along_x = NEIGHBOURS[d].row != 0;
+        float sign    = along_x ? NEIGHBOURS[d].row : NEIGHBOURS[d].col;
+        float facing  = (along_x ? normal.x : normal.z) * sign;
+        if (facing < 1.0f - BAKE_EPSILON) {
+            continue;
+        }
+
+        float plane   = (along_x ? world_row : world_col) * TILE_SIZE + sign * half;
+        bool  on_side = true;
+        for (int i = 0; i < 3; i++) {
+            float v = along_x ? p[i].x : p[i].z;
+            on_side = on_side && (fabsf(v - plane) < BAKE_EPSILON);
+        }
+        if (!on_side) {
+            continue;
+        }
+
+        int next_row = (int)row + NEIGHBOURS[d].row;
+        int next_col = (int)col + NEIGHBOURS[d].col;
+        return grid_index_valid(grid, next_row, next_col) &&
+               tiles_is_solid(tiles, grid_at(grid, next_row, next_col)->raw_value);
+    }
+    return false;
+}
+
+static void bake_part(BakedChunk* chunk, BakeBuffer* buffers, int* buffers_count, Grid grid, TileRenderer* tiles,
+                      size_t row, size_t col, size_t world_row, size_t world_col, TilePart part) {
+    Model* model     = part.model;
+    Matrix transform = tiles_part_transform(part, world_row, world_col);
+    Matrix normal_m  = MatrixTranspose(MatrixInvert(transform));
+    normal_m.m12 = normal_m.m13 = normal_m.m14 = 0.0f;
+
+    for (int m = 0; m < model->meshCount; m++) {
+        Mesh        mesh   = model->meshes[m];
+        BakeBuffer* buffer = bake_buffer(buffers, buffers_count, model->materials[model->meshMaterial[m]]);
+        chunk->stats.vertices_before += mesh.vertexCount;
+        chunk->stats.triangles_before += mesh.triangleCount;
+
+        for (int t = 0; t < mesh.triangleCount; t++) {
+            Vector3 p[3], n[3];
+            Vector2 uv[3];
+            for (int k = 0; k < 3; k++) {
+                int v = mesh.indices ? mesh.indices[t * 3 + k] : t * 3 + k;
+                p[k]  = Vector3Transform((Vector3){mesh.vertices[v * 3], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2]},
+                                         transform);
+                uv[k] = mesh.texcoords ? (Vector2){mesh.texcoords[v * 2], mesh.texcoords[v * 2 + 1]} : Vector2Zero();
+                n[k]  = mesh.normals ? Vector3Normalize(Vector3Transform(
+                                          (Vector3){mesh.normals[v * 3], mesh.normals[v * 3 + 1], mesh.normals[v * 3 + 2]},
+                                          normal_m))
+                                    : Vector3Zero();
+            }
+
+            Vector3 face = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p[1], p[0]), Vector3Subtract(p[2], p[0])));
+            if (!mesh.normals) {
+                n[0] = n[1] = n[2] = face;
+            }
+            if (face_hidden(grid, tiles, row, col, world_row, world_col, p, face)) {
+                continue;
+            }
+
+            for (int k = 0; k < 3; k++) {
+                bake_buffer_push(buffer, p[k], uv[k], n[k]);
+            }
+        }
+    }
+}
+
+// Bakes the BAKE_CHUNK_SIZE square of grid starting at (first_row, first_col)
+// as the chunk (chunk_row, chunk_col) of the world.
+static BakedChunk bake_region(Grid grid, TileRenderer* tiles, size_t first_row, size_t first_col, size_t chunk_row,
+                              size_t chunk_col) {
+    BakedChunk chunk = {0};
+    chunk.row        = chunk_row;
+    chunk.col        = chunk_col;
+
+    BakeBuffer buffers[BAKE_MATERIALS_MAX];
+    int        buffers_count = 0;
+
+    size_t world_row = chunk_row * BAKE_CHUNK_SIZE;
+    size_t world_col = chunk_col * BAKE_CHUNK_SIZE;
+    for (size_t x = first_row; (x < first_row + BAKE_CHUNK_SIZE) && (x < grid.rows); x++) {
+        for (size_t y = first_col; (y < first_col + BAKE_CHUNK_SIZE) && (y < grid.cols); y++) {
+            TileDef* def = tiles_def(tiles, grid_at(grid, x, y)->raw_value);
+            for (int p = 0; p < def->parts_count; p++) {
+                bake_part(&chunk, buffers, &buffers_count, grid, tiles, x, y, world_row + x - first_row,
+                          world_col + y - first_col, def->parts[p]);
+            }
+        }
+    }
+
+    for (int i = 0; i < buffers_count; i++) {
+        BakeBuffer* buffer = &buffers[i];
+        if (buffer->count == 0) {
+            continue;
+        }
+        BakedMesh* baked          = &chunk.meshes[chunk.meshes_count++];
+        baked->material           = buffer->material;
+        baked->transform          = MatrixIdentity();
+        baked->mesh               = (Mesh){0};
+        baked->mesh.vertexCount   = buffer->count;
+        baked->mesh.triangleCount = buffer->count / 3;
+        baked->mesh.vertices      = buffer->vertices;
+        baked->mesh.texcoords     = buffer->texcoords;
+        baked->mesh.normals       = buffer->normals;
+
+        // tiles next to each other share their border vertices once welded
+        MeshOptStats opt = {0};
+        mesh_opt_optimize(&baked->mesh, &opt);
+        chunk.stats.vertices_after += baked->mesh.vertexCount;
+        chunk.stats.triangles_after += baked->mesh.triangleCount;
+        chunk.stats.misses_before += opt.misses_before;
+        chunk.stats.misses_after += opt.misses_after;
+
+        BoundingBox bounds = GetMeshBoundingBox(baked->mesh);
+        chunk.bounds.min   = chunk.meshes_count == 1 ? bounds.min : Vector3Min(chunk.bounds.min, bounds.min);
+        chunk.bounds.max   = chunk.meshes_count == 1 ? bounds.max : Vector3Max(chunk.bounds.max, bounds.max);
+    }
+    return chunk;
+}
+
+BakedChunk bake_chunk(Grid grid, TileRenderer* tiles, size_t chunk_row, size_t chunk_col) {
+    return bake_region(grid, tiles, chunk_row * BAKE_CHUNK_SIZE, chunk_col * BAKE_CHUNK_SIZE, chunk_row, chunk_col);
+}
+
+// Only the chunk cels are known here, faces on the chunk border are always kept.
+BakedChunk bake_chunk_cels(Grid cels, TileRenderer* tiles, size_t chunk_row, size_t chunk_col) {
+    return bake_region(cels, tiles, 0, 0, chunk_row, chunk_col);
+}
+
+// Shader the quantized chunks are drawn with instead of the one of their
+// material, it reads the MeshQuantVertex layout. Must compile, a fallback to
+// the default shader would read the packed normals as floats.
+void bake_set_shader(Shader shader) {
+    if (!IsShaderReady(shader) || (shader.id == rlGetShaderIdDefault())) {
+        printf("[ERROR] Could not load the quantized chunk shader\n");
+        exit(EXIT_FAILURE);
+    }
+    quantized_shader = shader;
+}
+
+void bake_chunk_upload(BakedChunk* chunk) {
+    for (int i = 0; i < chunk->meshes_count; i++) {
+        BakedMesh* baked = &chunk->meshes[i];
+        if (BAKE_QUANTIZE) {
+            baked->transform = mesh_quant_upload(&baked->mesh);
+            // without vertex arrays the floats were uploaded instead
+            if ((baked->mesh.vaoId != 0) && (quantized_shader.id != 0)) {
+                baked->material.shader = quantized_shader;
+            }
+        } else {
+            UploadMesh(&baked->mesh, false);
+        }
+    }
+    chunk->uploaded = true;
+}
+
+// empty chunks are not even tested
+void bake_chunk_draw(BakedChunk* chunk, const Frustum* frustum, CullStats* stats) {
+    if (!chunk->uploaded || (chunk->meshes_count == 0) || !cull_box(frustum, chunk->bounds, stats)) {
+        return;
+    }
+    for (int i = 0; i < chunk->meshes_count; i++) {
+        DrawMesh(chunk->meshes[i].mesh, chunk->meshes[i].material, chunk->meshes[i].transform);
+    }
+}
+
+void bake_chunk_free(BakedChunk* chunk) {
+    // materials are borrowed from the tile models, only the meshes are owned
+    for (int i = 0; i < chunk->meshes_count; i++) {
+        UnloadMesh(chunk->meshes[i].mesh);
+    }
+    chunk->meshes_count = 0;
+    chunk->uploaded     = false;
+}
+
+static void stats_add(BakeStats* total, BakeStats stats) {
+    total->vertices_before += stats.vertices_before;
+    total->triangles_before += stats.triangles_before;
+    total->vertices_after += stats.vertices_after;
+    total->triangles_after += stats.triangles_after;
+    total->misses_before += stats.misses_before;
+    total->misses_after += stats.misses_after;
+}
+
+BakedWorld bake_world(Grid grid, TileRenderer* tiles) {
+    BakedWorld world = {0};
+    world.rows       = (grid.rows + BAKE_CHUNK_SIZE - 1) / BAKE_CHUNK_SIZE;
+    world.cols       = (grid.cols + BAKE_CHUNK_SIZE - 1) / BAKE_CHUNK_SIZE;
+    world.chunks     = (BakedChunk*)calloc(world.rows * world.cols, sizeof(BakedChunk));
+
+    for (size_t x = 0; x < world.rows; x++) {
+        for (size_t y = 0; y < world.cols; y++) {
+            BakedChunk* chunk = &world.chunks[x * world.cols + y];
+            *chunk            = bake_chunk(grid, tiles, x, y);
+            bake_chunk_upload(chunk);
+            stats_add(&world.stats, chunk->stats);
+        }
+    }
+
+    float triangles = world.stats.triangles_after > 0 ? (float)world.stats.triangles_after : 1.0f;
+    // position, normal and texcoord floats or the quantized vertex
+    size_t vertex_size = BAKE_QUANTIZE ? sizeof(MeshQuantVertex) : 8 * sizeof(float);
+    printf("[INFO] Baked map: %zux%zu chunks, vertices %ld -> %ld, triangles %ld -> %ld, ACMR %.2f -> %.2f, "
+           "vertex buffers %zu KB\n",
+           world.rows, world.cols, world.stats.vertices_before, world.stats.vertices_after,
+           world.stats.triangles_before, world.stats.triangles_after, world.stats.misses_before / triangles,
+           world.stats.misses_after / triangles, world.stats.vertices_after * vertex_size / 1024);
+    return world;
+}
+
+void bake_world_draw(BakedWorld* world, const Frustum* frustum, CullStats* stats) {
+    for (size_t i = 0; i < world->rows * world->cols; i++) {
+        bake_chunk_draw(&world->chunks[i], frustum, stats);
+    }
+}
+
+void bake_world_free(BakedWorld* world) {
+    for (size_t i = 0; i < world->rows * world->cols; i++) {
+        bake_chunk_free(&world->chunks[i]);
+    }
+    free(world->chunks);
+    *world = (BakedWorld){0};
+}
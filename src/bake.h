@@ -0,0 +1,60 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "cull.h"
+#include "map.h"
+#include "tiles.h"
+
+#define BAKE_CHUNK_SIZE 16
+#define BAKE_MATERIALS_MAX 16
+#define BAKE_QUANTIZE true // chunks uploaded in the MeshQuantVertex layout, half the vertex memory
+
+typedef struct BakeStats BakeStats;
+typedef struct BakedMesh BakedMesh;
+typedef struct BakedChunk BakedChunk;
+typedef struct BakedWorld BakedWorld;
+
+struct BakeStats {
+    long vertices_before;
+    long triangles_before;
+    long vertices_after;
+    long triangles_after;
+    long misses_before; // vertex cache misses, see MeshOptStats
+    long misses_after;
+};
+
+// Every face of one material inside a chunk, already in world space.
+struct BakedMesh {
+    Mesh mesh;
+    Material material;
+    Matrix transform; // decodes the quantized positions, identity for floats
+};
+
+struct BakedChunk {
+    size_t row;
+    size_t col;
+    BakedMesh meshes[BAKE_MATERIALS_MAX];
+    int meshes_count;
+    BoundingBox bounds; // of every baked vertex, in world space
+    BakeStats stats;
+    bool uploaded;
+};
+
+struct BakedWorld {
+    BakedChunk* chunks;
+    size_t rows;
+    size_t cols;
+    BakeStats stats;
+};
+
+BakedChunk bake_chunk(Grid grid, TileRenderer* tiles, size_t chunk_row, size_t chunk_col);
+BakedChunk bake_chunk_cels(Grid cels, TileRenderer* tiles, size_t chunk_row, size_t chunk_col);
+void bake_set_shader(Shader shader);
+void bake_chunk_upload(BakedChunk* chunk);
+void bake_chunk_draw(BakedChunk* chunk, const Frustum* frustum, CullStats* stats);
+void bake_chunk_free(BakedChunk* chunk);
+
+BakedWorld bake_world(Grid grid, TileRenderer* tiles);
+void bake_world_draw(BakedWorld* world, const Frustum* frustum, CullStats* stats);
+void bake_world_free(BakedWorld* world);
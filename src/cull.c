@@ -0,0 +1,61 @@
+#include "cull.h"
+#include <math.h>
+#include "raymath.h"
+#include "rlgl.h"
+
+static Plane plane_normalize(float a, float b, float c, float d) {
+    float length = sqrtf(a * a + b * b + c * c);
+    return (Plane){(Vector3){a / length, b / length, c / length}, d / length};
+}
+
+// Same projection BeginMode3D sets up, so the frustum matches what gets drawn.
+static Matrix camera_projection(Camera3D camera, float aspect) {
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        return MatrixPerspective(camera.fovy * DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+    }
+    double top   = camera.fovy / 2.0;
+    double right = top * aspect;
+    return MatrixOrtho(-right, right, -top, top, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+}
+
+// Planes are read straight from the rows of the view projection matrix
+// (Gribb & Hartmann), which works for both projections.
+Frustum frustum_from_camera(Camera3D camera, float aspect) {
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix m    = MatrixMultiply(view, camera_projection(camera, aspect));
+
+    Frustum frustum;
+    frustum.planes[0] = plane_normalize(m.m3 + m.m0, m.m7 + m.m4, m.m11 + m.m8, m.m15 + m.m12);  // left
+    frustum.planes[1] = plane_normalize(m.m3 - m.m0, m.m7 - m.m4, m.m11 - m.m8, m.m15 - m.m12);  // right
+    frustum.planes[2] = plane_normalize(m.m3 + m.m1, m.m7 + m.m5, m.m11 + m.m9, m.m15 + m.m13);  // bottom
+    frustum.planes[3] = plane_normalize(m.m3 - m.m1, m.m7 - m.m5, m.m11 - m.m9, m.m15 - m.m13);  // top
+    frustum.planes[4] = plane_normalize(m.m3 + m.m2, m.m7 + m.m6, m.m11 + m.m10, m.m15 + m.m14); // near
+    frustum.planes[5] = plane_normalize(m.m3 - m.m2, m.m7 - m.m6, m.m11 - m.m10, m.m15 - m.m14); // far
+    return frustum;
+}
+
+// A box is out when its corner furthest along a plane normal is still outside it.
+bool frustum_box_visible(const Frustum* frustum, BoundingBox box) {
+    for (int i = 0; i < 6; i++) {
+        Plane   plane = frustum->planes[i];
+        Vector3 corner = {
+            plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+            plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+            plane.normal.z >= 0.0f ? box.max.z : box.min.z,
+        };
+        if (Vector3DotProduct(plane.normal, corner) + plane.distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// frustum_box_visible that also counts, a NULL frustum lets everything through
+bool cull_box(const Frustum* frustum, BoundingBox box, CullStats* stats) {
+    bool visible = !frustum || frustum_box_visible(frustum, box);
+    if (stats) {
+        stats->tested++;
+        stats->visible += visible;
+    }
+    return visible;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdbool.h>
+#include "raylib.h"
+
+typedef struct Plane Plane;
+typedef struct Frustum Frustum;
+typedef struct CullStats CullStats;
+
+// normal . p + distance >= 0 on the inner side
+struct Plane {
+    Vector3 normal;
+    float distance;
+};
+
+struct Frustum {
+    Plane planes[6];
+};
+
+// chunks checked against the frustum and the ones that passed, reset every frame
+struct CullStats {
+    int tested;
+    int visible;
+};
+
+Frustum frustum_from_camera(Camera3D camera, float aspect);
+bool frustum_box_visible(const Frustum* frustum, BoundingBox box);
+bool cull_box(const Frustum* frustum, BoundingBox box, CullStats* stats);
@@ -10,132 +10,1220 @@
   ~wave animation~
   ~~crossed~~
   __underline__
+  ^^outline^^ (distance field fonts only)
 
   + user defined line spacing
+
+  The markup is compiled once into positioned glyph runs and cached, drawing
+  a text that was already seen only walks its glyphs.
+
+  Glyphs and decoration lines are emitted as quads grouped by font atlas, so
+  a paragraph is one draw per atlas. The lines sample the white rectangle
+  LoadFontEx adds to the bottom-right corner of the atlas.
+
+  With SetEmotionalTextShader (shader/emotional_text.vs) the quads of
+  animated texts, and of the ones drawn EMOTIONAL_TEXT_UPLOAD_DRAWS times,
+  are uploaded once and the wave runs in the vertex shader, so they are not
+  rebuilt every frame. Texts that change every frame are not worth a buffer:
+  they and everything without the shader are emitted through the rlgl batch.
+
+  Fonts registered with SetEmotionalTextFontSdf hold signed distance fields
+  and are drawn by the program set with SetEmotionalTextSdfShader
+  (shader/emotional_text_sdf.fs), one atlas for every size. Bold thickens
+  the glyphs there and the outline style draws a border around them, its
+  size and colour set with SetEmotionalTextOutline.
+
+  Fonts given a chain of font files with SetEmotionalTextFontChain draw the
+  codepoints their baked atlas lacks too. The first file of the chain with
+  the codepoint rasterizes it on first use into atlas pages shared by the
+  font, the least recently used glyphs are replaced once the pages are full.
+
+  An EmotionalFlow wraps markup at a width: its words are measured once,
+  appending only measures the new ones and wraps from the last line, and a
+  new width only wraps the measured words again.
 */
 
 #pragma once
 
 #include "raylib.h"
+#include "rlgl.h"
+#include "raymath.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lru.h"
+#include "hash.h"
+
+#define EMOTIONAL_TEXT_CACHE_SIZE 64
+#define EMOTIONAL_TEXT_UPLOAD_DRAWS 8
+#define EMOTIONAL_SDF_FONTS_MAX 8
+
+// Glyph atlas pages of the fonts with a fallback chain
+#define EMOTIONAL_CHAIN_FONTS_MAX 4
+#define EMOTIONAL_CHAIN_FACES_MAX 4
+#define EMOTIONAL_ATLAS_PAGES_MAX 4
+#define EMOTIONAL_ATLAS_PAGE_SIZE 512
+#define EMOTIONAL_ATLAS_BUCKETS 256
+#define EMOTIONAL_TEXT_BATCHES_MAX (4*(1 + EMOTIONAL_ATLAS_PAGES_MAX))
+
+//Parameters for the waves effect, also in shader/emotional_text.vs
+#define EMOTIONAL_WAVE_X_RANGE 1.0f
+#define EMOTIONAL_WAVE_Y_RANGE 2.0f
+#define EMOTIONAL_WAVE_X_SPEED 4
+#define EMOTIONAL_WAVE_Y_SPEED 4
+#define EMOTIONAL_WAVE_X_OFFSET 0.5f
+#define EMOTIONAL_WAVE_Y_OFFSET 0.5f
+
+typedef enum {
+    EMOTIONAL_ITALIC    = 1 << 0,
+    EMOTIONAL_BOLD      = 1 << 1,
+    EMOTIONAL_WAVE      = 1 << 2,
+    EMOTIONAL_CROSSED   = 1 << 3,
+    EMOTIONAL_UNDERLINE = 1 << 4,
+    EMOTIONAL_OUTLINE   = 1 << 5,
+} EmotionalStyle;
+
+// A drawable glyph, spaces and markup only move the following ones
+typedef struct {
+    int codepoint;
+    int index;          // Glyph index in the font of its run
+    int slot;           // Atlas slot of the font of its run, -1 when baked
+    int source;         // Byte offset in the text, phase of the wave
+    Vector2 offset;     // From the text position
+    float advance;
+} EmotionalGlyph;
+
+// Consecutive glyphs with the same style, drawn with the same font
+typedef struct {
+    int style;
+    int first;
+    int count;
+} EmotionalRun;
+
+// A textured rectangle, a glyph or a crossed/underline segment
+typedef struct {
+    Rectangle dest;     // From the text position
+    Rectangle uv;       // Normalized in the atlas
+    int glyph;          // Glyph it belongs to
+    int style;
+} EmotionalQuad;
+
+// Quads sharing a font atlas, drawn together
+typedef struct {
+    Texture2D texture;
+    int first;
+    int count;
+} EmotionalBatch;
+
+// Markup compiled for one set of fonts and sizes, immutable once built
+typedef struct {
+    LruKey key;         // First, the cache entries are in an Lru
+    char *text;         // Source markup, told apart from texts with the same hash
+    Font fonts[4];      // Indexed by the italic and bold style bits
+    float fontSize;
+    float spacing;
+    float linespacing;
+    EmotionalGlyph* glyphs;
+    int glyphCount;
+    EmotionalRun* runs;
+    int runCount;
+    EmotionalQuad* quads;
+    int quadCount;
+    EmotionalBatch batches[EMOTIONAL_TEXT_BATCHES_MAX];
+    int batchCount;
+    Vector2 size;
+    bool sdf;           // Fonts are distance fields
+    bool paged;         // Glyphs in atlas pages, stale once one is replaced
+    bool animated;      // Has a style moving with time, uploaded on first draw
+    int draws;          // Drawn through the rlgl batch so far
+    unsigned int vao;   // Quads on the GPU, once worth uploading
+    unsigned int vbos[3];
+} EmotionalText;
+
+// Compiled texts by hash, the least recently used one is replaced when full
+static struct {
+    EmotionalText entries[EMOTIONAL_TEXT_CACHE_SIZE];
+    Lru lru;
+    unsigned long hits;
+    unsigned long misses;
+} EmotionalTextCache = {.lru = {EmotionalTextCache.entries, sizeof(EmotionalText), EMOTIONAL_TEXT_CACHE_SIZE}};
+
+typedef struct {
+    Shader shader;
+    int locTime;
+    int locGlyph;
+    int locOutlineSize;
+    int locOutlineColor;
+} EmotionalTextProgram;
+
+static struct {
+    EmotionalTextProgram bitmap;
+    EmotionalTextProgram sdf;
+    unsigned int sdfTextures[EMOTIONAL_SDF_FONTS_MAX];
+    int sdfCount;
+    float outlineSize;
+    Color outlineColor;
+} EmotionalTextGpu = {.outlineSize = 0.15f, .outlineColor = {0, 0, 0, 255}};
+
+// A font file of a fallback chain, its unicode cmap located once
+typedef struct {
+    unsigned char *data;
+    int size;
+    int cmap;           // Offset of the format 4 or 12 cmap subtable
+} EmotionalFace;
+
+// A glyph rasterized in an atlas page
+typedef struct {
+    int codepoint;      // 0 when free
+    Rectangle rec;      // In the page, without padding
+    GlyphInfo info;     // Metrics only, the pixels are in the page
+    unsigned long lastUsed;
+    int next;           // Next slot of the same bucket, -1 at the end
+} EmotionalAtlasSlot;
+
+// Glyphs a baked font lacks, from its chain of font files, in fixed cells
+typedef struct {
+    unsigned int fontTexture;   // Baked font extended
+    int baseSize;
+    int padding;
+    int type;
+    EmotionalFace faces[EMOTIONAL_CHAIN_FACES_MAX];
+    int faceCount;
+    Texture2D pages[EMOTIONAL_ATLAS_PAGES_MAX];
+    int pageCount;
+    int cell;           // Cell side in pixels, a glyph and its padding
+    int cellsPerRow;
+    int slotsPerPage;   // The last cell of a page holds the white rectangle
+    EmotionalAtlasSlot *slots;
+    int slotCount;      // Slots handed out so far, all of them once full
+    int buckets[EMOTIONAL_ATLAS_BUCKETS];
+} EmotionalAtlas;
+
+static struct {
+    EmotionalAtlas entries[EMOTIONAL_CHAIN_FONTS_MAX];
+    int count;
+    unsigned long rasterized;
+    unsigned long evictions;
+} EmotionalTextAtlases = {0};
+
+// A word and the separator after it, measured once and wrapped at any width
+typedef struct {
+    int start;          // Byte offset in the flow text, markup included
+    int length;         // Bytes of the word, the separator follows
+    int separator;      // Spaces then at most one line break
+    int style;          // At the word start
+    float width;
+    float space;        // Width of the separator spaces
+    bool newline;       // The separator ends with a line break
+} EmotionalWord;
+
+// A wrapped line, up to the first word of the next one
+typedef struct {
+    int word;
+    int wrapped;        // Byte offset in the wrapped text
+    float width;
+} EmotionalLine;
+
+// Markup wrapped at a width, appended to and resized without measuring it again
+typedef struct {
+    Font fonts[4];
+    float fontSize;
+    float spacing;
+    float linespacing;
+    float width;
+    char *text;
+    int length;
+    int textCapacity;
+    EmotionalWord *words;
+    int wordCount;
+    int wordCapacity;
+    EmotionalLine *lines;
+    int lineCount;
+    int lineCapacity;
+    char *wrapped;      // The text with a line break at every wrap, to draw
+    int wrappedLength;
+    int wrappedCapacity;
+} EmotionalFlow;
 
 float EMOTIONAL_TEXT_TIMER;
 
 void UpdateEmotionalTextTimer();
+void SetEmotionalTextShader(Shader shader);
+void SetEmotionalTextSdfShader(Shader shader);
+void SetEmotionalTextFontSdf(Font font);
+void SetEmotionalTextOutline(float size, Color color);
+void SetEmotionalTextFontChain(Font font, const char **paths, int count);
+void UnloadEmotionalTextCache(void);
+EmotionalText* CompileEmotionalText(Font main_font, Font italic_font, Font bold_font, Font bolditalic_font, const char *text, float fontSize, float spacing, float linespacing);
+void DrawEmotionalTextCompiled(EmotionalText* compiled, Vector2 position, float time, Color color);
+void DrawEmotionalTextRevealed(EmotionalText* compiled, Vector2 position, int glyphs, float time, Color color);
 void DrawEmotionalTextEx(Font main_font, Font italic_font, Font bold_font, Font bolditalic_font, const char *text, Vector2 position, float fontSize, float spacing, float linespacing, float time, Color color);
+EmotionalFlow LoadEmotionalFlow(Font main_font, Font italic_font, Font bold_font, Font bolditalic_font, float fontSize, float spacing, float linespacing, float width);
+void AppendEmotionalFlow(EmotionalFlow *flow, const char *text);
+void SetEmotionalFlowWidth(EmotionalFlow *flow, float width);
+void DrawEmotionalFlow(EmotionalFlow *flow, Vector2 position, int glyphs, float time, Color color);
+void UnloadEmotionalFlow(EmotionalFlow *flow);
 
 void DrawEmotionalText(Font font, const char* text, Vector2 pos, int fontsize, int font_spc, Color color) {
     DrawEmotionalTextEx(font, font, font, font, text, (Vector2){pos.x, pos.y}, fontsize, 1, font_spc, EMOTIONAL_TEXT_TIMER, color);
 }
 
-void DrawEmotionalTextEx(Font main_font, Font italic_font,
-                         Font bold_font, Font bolditalic_font,
-                         const char *text,
-                         Vector2 position,
-                         float fontSize,
-                         float spacing,
-                         float linespacing,
-                         float time,Color color) {
-    Font font = main_font;
+// True when the markup has a style that moves with time (~wave~)
+bool IsEmotionalTextAnimated(const char* text) {
+    for (int i = 0; text[i]; i++) {
+        if (text[i] != '~') continue;
+        if (text[i+1] != '~') return true;
+        i++;
+    }
+    return false;
+}
+
+// The whole text is laid out, only the first glyphs are drawn, markup and spaces do not count
+void DrawEmotionalTextReveal(Font font, const char* text, int glyphs, Vector2 pos, int fontsize, int font_spc, Color color) {
+    EmotionalText *compiled = CompileEmotionalText(font, font, font, font, text, fontsize, 1, font_spc);
+    DrawEmotionalTextRevealed(compiled, pos, glyphs, EMOTIONAL_TEXT_TIMER, color);
+}
+
+// FNV-1a over the text and everything that changes its layout
+static unsigned long long EmotionalTextHash(const Font fonts[4], const char *text, float fontSize, float spacing, float linespacing) {
+    float params[3] = {fontSize, spacing, linespacing};
+    unsigned int keys[11] = {0};
+    for (int i = 0; i < 4; i++) {
+        keys[i*2] = fonts[i].texture.id;
+        keys[i*2 + 1] = (unsigned int)fonts[i].baseSize;
+    }
+    memcpy(&keys[8], params, sizeof(params));
+    return hash_bytes(hash_string(HASH_OFFSET, text), keys, sizeof(keys));
+}
+
+static unsigned int EmotionalReadU16(const unsigned char *data) { return (data[0] << 8) | data[1]; }
+static unsigned int EmotionalReadU32(const unsigned char *data) { return ((unsigned int)EmotionalReadU16(data) << 16) | EmotionalReadU16(data + 2); }
+
+// Offset of the unicode cmap subtable, 0 when the file has none we read
+static int EmotionalFaceFindCmap(const unsigned char *data, int size) {
+    if (size < 12) return 0;
+    int tables = EmotionalReadU16(data + 4);
+    int cmap = 0;
+    for (int i = 0; i < tables && 12 + (i + 1)*16 <= size; i++) {
+        const unsigned char *record = data + 12 + i*16;
+        if (memcmp(record, "cmap", 4) == 0) cmap = EmotionalReadU32(record + 8);
+    }
+    if (cmap == 0 || cmap + 4 > size) return 0;
+
+    // Full unicode (3, 10 or 0, 4) before the BMP only ones (3, 1 or 0, 3)
+    int best = 0;
+    int bestRank = 0;
+    int encodings = EmotionalReadU16(data + cmap + 2);
+    for (int i = 0; i < encodings && cmap + 4 + (i + 1)*8 <= size; i++) {
+        const unsigned char *record = data + cmap + 4 + i*8;
+        int platform = EmotionalReadU16(record);
+        int encoding = EmotionalReadU16(record + 2);
+        int offset = cmap + EmotionalReadU32(record + 4);
+        if (offset + 16 > size) continue;
+        int format = EmotionalReadU16(data + offset);
+        int rank = 0;
+        if (format == 12 && ((platform == 3 && encoding == 10) || (platform == 0 && encoding == 4))) rank = 2;
+        if (format == 4 && ((platform == 3 && encoding == 1) || platform == 0)) rank = 1;
+        if (rank > bestRank) {
+            best = offset;
+            bestRank = rank;
+        }
+    }
+    return best;
+}
+
+// True when the cmap maps the codepoint to a glyph other than .notdef
+static bool EmotionalFaceHasCodepoint(EmotionalFace face, int codepoint) {
+    const unsigned char *table = face.data + face.cmap;
+    if (EmotionalReadU16(table) == 12) {
+        unsigned int groups = EmotionalReadU32(table + 12);
+        for (unsigned int i = 0; i < groups && face.cmap + 16 + (i + 1)*12 <= (unsigned int)face.size; i++) {
+            const unsigned char *group = table + 16 + i*12;
+            unsigned int first = EmotionalReadU32(group);
+            unsigned int last = EmotionalReadU32(group + 4);
+            if ((unsigned int)codepoint < first) break;
+            if ((unsigned int)codepoint <= last) return EmotionalReadU32(group + 8) + (codepoint - first) != 0;
+        }
+        return false;
+    }
+
+    if (codepoint > 0xffff) return false;
+    int segments = EmotionalReadU16(table + 6)/2;
+    if (face.cmap + 16 + segments*8 > face.size) return false;
+    for (int i = 0; i < segments; i++) {
+        int end = EmotionalReadU16(table + 14 + i*2);
+        if (codepoint > end) continue;
+        int start = EmotionalReadU16(table + 16 + segments*2 + i*2);
+        if (codepoint < start) return false;
+        int delta = EmotionalReadU16(table + 16 + segments*4 + i*2);
+        const unsigned char *rangeOffset = table + 16 + segments*6 + i*2;
+        if (EmotionalReadU16(rangeOffset) == 0) return ((codepoint + delta) & 0xffff) != 0;
+        const unsigned char *glyph = rangeOffset + EmotionalReadU16(rangeOffset) + (codepoint - start)*2;
+        if (glyph + 2 > face.data + face.size) return false;
+        return EmotionalReadU16(glyph) != 0;
+    }
+    return false;
+}
+
+// Atlas extending the font, NULL when it has no fallback chain
+static EmotionalAtlas* EmotionalAtlasFor(Font font) {
+    for (int i = 0; i < EmotionalTextAtlases.count; i++) {
+        if (EmotionalTextAtlases.entries[i].fontTexture == font.texture.id) return &EmotionalTextAtlases.entries[i];
+    }
+    return NULL;
+}
+
+static Rectangle EmotionalAtlasCell(const EmotionalAtlas *atlas, int slot) {
+    int cell = slot%atlas->slotsPerPage;
+    return (Rectangle){(float)((cell%atlas->cellsPerRow)*atlas->cell), (float)((cell/atlas->cellsPerRow)*atlas->cell),
+                       (float)atlas->cell, (float)atlas->cell};
+}
+
+static Texture2D EmotionalAtlasPage(const EmotionalAtlas *atlas, int slot) {
+    return atlas->pages[slot/atlas->slotsPerPage];
+}
+
+// Blank page in the baked atlas format, white in the bottom-right corner for the lines
+static void EmotionalAtlasAddPage(EmotionalAtlas *atlas) {
+    int size = EMOTIONAL_ATLAS_PAGE_SIZE;
+    unsigned char *pixels = (unsigned char*)calloc(size*size, 2);
+    for (int i = 0; i < size*size; i++) pixels[i*2] = 255;
+    for (int y = size - 3; y < size; y++) {
+        for (int x = size - 3; x < size; x++) pixels[(y*size + x)*2 + 1] = 255;
+    }
+
+    Image image = {pixels, size, size, 1, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA};
+    Texture2D page = LoadTextureFromImage(image);
+    if (atlas->type == FONT_SDF) SetTextureFilter(page, TEXTURE_FILTER_BILINEAR);
+    atlas->pages[atlas->pageCount++] = page;
+    free(pixels);
+}
+
+static void EmotionalAtlasUnlink(EmotionalAtlas *atlas, int slot) {
+    int *link = &atlas->buckets[(unsigned int)atlas->slots[slot].codepoint%EMOTIONAL_ATLAS_BUCKETS];
+    while (*link != slot) link = &atlas->slots[*link].next;
+    *link = atlas->slots[slot].next;
+}
+
+// A free slot, a new page or the least recently used glyph not drawn this tick, -1 when none
+static int EmotionalAtlasTakeSlot(EmotionalAtlas *atlas, unsigned long tick) {
+    if (atlas->slotCount == atlas->pageCount*atlas->slotsPerPage && atlas->pageCount < EMOTIONAL_ATLAS_PAGES_MAX) {
+        EmotionalAtlasAddPage(atlas);
+    }
+    if (atlas->slotCount < atlas->pageCount*atlas->slotsPerPage) return atlas->slotCount++;
+
+    int oldest = -1;
+    for (int i = 0; i < atlas->slotCount; i++) {
+        if (atlas->slots[i].lastUsed >= tick) continue;
+        if (oldest == -1 || atlas->slots[i].lastUsed < atlas->slots[oldest].lastUsed) oldest = i;
+    }
+    if (oldest != -1) {
+        EmotionalAtlasUnlink(atlas, oldest);
+        EmotionalTextAtlases.evictions++;
+    }
+    return oldest;
+}
+
+// Rasterizes the codepoint from the face into the slot cell, cropped to it
+static void EmotionalAtlasRasterize(EmotionalAtlas *atlas, int slot, EmotionalFace face, int codepoint) {
+    GlyphInfo *glyph = LoadFontData(face.data, face.size, atlas->baseSize, &codepoint, 1, atlas->type);
+    Rectangle cell = EmotionalAtlasCell(atlas, slot);
+    int side = atlas->cell;
+    int room = side - 2*atlas->padding;
+    int width = glyph ? glyph->image.width : 0;
+    int height = glyph ? glyph->image.height : 0;
+    if (width > room || height > room) {
+        TraceLog(LOG_WARNING, "EMOTIONAL: Glyph 0x%04x is %ix%i, cropped to %ix%i", codepoint, width, height, room, room);
+        width = width < room ? width : room;
+        height = height < room ? height : room;
+    }
+
+    unsigned char *pixels = (unsigned char*)calloc(side*side, 2);
+    for (int i = 0; i < side*side; i++) pixels[i*2] = 255;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char alpha = ((unsigned char*)glyph->image.data)[y*glyph->image.width + x];
+            pixels[((y + atlas->padding)*side + x + atlas->padding)*2 + 1] = alpha;
+        }
+    }
+    UpdateTextureRec(EmotionalAtlasPage(atlas, slot), cell, pixels);
+    free(pixels);
+
+    EmotionalAtlasSlot *entry = &atlas->slots[slot];
+    entry->codepoint = codepoint;
+    entry->rec = (Rectangle){cell.x + atlas->padding, cell.y + atlas->padding, (float)width, (float)height};
+    entry->info = glyph ? *glyph : (GlyphInfo){0};
+    entry->info.value = codepoint;
+    entry->info.image = (Image){0};
+    int *bucket = &atlas->buckets[(unsigned int)codepoint%EMOTIONAL_ATLAS_BUCKETS];
+    entry->next = *bucket;
+    *bucket = slot;
+    EmotionalTextAtlases.rasterized++;
+    if (glyph) UnloadFontData(glyph, 1);
+}
+
+// Slot of a codepoint the baked font lacks, rasterized on first use, -1 when
+// the baked glyph is drawn, the codepoint itself or its fallback
+static int EmotionalAtlasGlyph(EmotionalAtlas *atlas, Font font, int codepoint, int index, unsigned long tick) {
+    if (font.glyphs[index].value == codepoint) return -1;
+
+    for (int slot = atlas->buckets[(unsigned int)codepoint%EMOTIONAL_ATLAS_BUCKETS]; slot != -1; slot = atlas->slots[slot].next) {
+        if (atlas->slots[slot].codepoint == codepoint) {
+            atlas->slots[slot].lastUsed = tick;
+            return slot;
+        }
+    }
+
+    for (int f = 0; f < atlas->faceCount; f++) {
+        if (!EmotionalFaceHasCodepoint(atlas->faces[f], codepoint)) continue;
+        int slot = EmotionalAtlasTakeSlot(atlas, tick);
+        if (slot == -1) {
+            TraceLog(LOG_WARNING, "EMOTIONAL: Glyph atlas of font %i full, 0x%04x not drawn", font.texture.id, codepoint);
+            return -1;
+        }
+        EmotionalAtlasRasterize(atlas, slot, atlas->faces[f], codepoint);
+        atlas->slots[slot].lastUsed = tick;
+        return slot;
+    }
+    return -1;
+}
+
+static void EmotionalAtlasUnload(EmotionalAtlas *atlas) {
+    for (int i = 0; i < atlas->pageCount; i++) UnloadTexture(atlas->pages[i]);
+    for (int i = 0; i < atlas->faceCount; i++) UnloadFileData(atlas->faces[i].data);
+    free(atlas->slots);
+}
+
+// Toggles the style of the markup starting the text, its length in bytes, 0 when none
+static int EmotionalTextMarkup(const char *text, int *style) {
+    if (text[0] == '*') {
+        *style ^= (text[1] == '*') ? EMOTIONAL_BOLD : EMOTIONAL_ITALIC;
+        return (text[1] == '*') ? 2 : 1;
+    }
+    if (text[0] == '~') {
+        *style ^= (text[1] == '~') ? EMOTIONAL_CROSSED : EMOTIONAL_WAVE;
+        return (text[1] == '~') ? 2 : 1;
+    }
+    if (text[0] == '_' && text[1] == '_') {
+        *style ^= EMOTIONAL_UNDERLINE;
+        return 2;
+    }
+    if (text[0] == '^' && text[1] == '^') {
+        *style ^= EMOTIONAL_OUTLINE;
+        return 2;
+    }
+    return 0;
+}
+
+// Advance of a codepoint in the font, its glyph index and atlas slot with it
+static float EmotionalTextAdvance(Font font, EmotionalAtlas *atlas, int codepoint, float scaleFactor, float spacing,
+                                  unsigned long tick, int *index, int *slot) {
+    *index = GetGlyphIndex(font, codepoint);
+    *slot = atlas ? EmotionalAtlasGlyph(atlas, font, codepoint, *index, tick) : -1;
+    GlyphInfo info = (*slot == -1) ? font.glyphs[*index] : atlas->slots[*slot].info;
+    Rectangle rec = (*slot == -1) ? font.recs[*index] : atlas->slots[*slot].rec;
+
+    if (info.advanceX == 0) return (float)rec.width*scaleFactor + spacing;
+    return (float)info.advanceX*scaleFactor + spacing;
+}
+
+static void EmotionalTextParse(EmotionalText *compiled, const char *text, float spacing, float linespacing) {
+    Font font = compiled->fonts[0];
+    EmotionalAtlas *atlas = EmotionalAtlasFor(font);
     int length = TextLength(text);      // Total length in bytes of the text, scanned by codepoints in loop
     int textOffsetY = 0;            // Offset between lines (on line break '\n')
     float textOffsetX = 0.0f;       // Offset X to next character to draw
-    float scaleFactor = fontSize/font.baseSize;     // Character quad scaling factor
-
-    //Style flags
-    bool flag_bold = false;
-    bool flag_italic = false;
-    bool flag_wave = false;
-    bool flag_crossed = false;
-    bool flag_underline = false;
-
-    //Parameters for the waves effect
-    float wave_x_range = 1;
-    float wave_y_range = 2;
-    int wave_x_speed = 4;
-    int wave_y_speed = 4;
-    float wave_x_offset = 0.5;
-    float wave_y_offset = 0.5;
+    float scaleFactor = compiled->fontSize/font.baseSize;     // Character quad scaling factor
+    int style = 0;
 
+    // Never more glyphs or runs than bytes
+    compiled->glyphs = (EmotionalGlyph*)malloc((length + 1)*sizeof(EmotionalGlyph));
+    compiled->runs = (EmotionalRun*)malloc((length + 1)*sizeof(EmotionalRun));
+    compiled->glyphCount = 0;
+    compiled->runCount = 0;
+    compiled->size = (Vector2){0.0f, compiled->fontSize};
 
     for (int i = 0; i < length;) {
-        // Get next codepoint from byte string and glyph index in font
+        // Get next codepoint from byte string
         int codepointByteCount = 0;
         int codepoint = GetCodepointNext(&text[i], &codepointByteCount);
-        int index = GetGlyphIndex(font, codepoint);
+        int markupByteCount = 0;
 
         if (codepoint == 0x3f) codepointByteCount = 1;
 
         if (codepoint == '\n') {
             textOffsetY += (int)((font.baseSize * linespacing)*scaleFactor);
             textOffsetX = 0.0f;
-        } else if (codepoint == '*') {
-            if (GetCodepointNext(&text[i+1], &codepointByteCount) == '*') {
-                flag_bold = !flag_bold;
-                codepointByteCount += 1;
-            } else {
-                flag_italic = !flag_italic;
-            }
-
+            compiled->size.y = textOffsetY + compiled->fontSize;
+        } else if ((markupByteCount = EmotionalTextMarkup(&text[i], &style)) > 0) {
+            codepointByteCount = markupByteCount;
             //Font Weight switching
-            if (flag_bold && flag_italic) {
-                font = bolditalic_font;
-            } else if (flag_bold) {
-                font = bold_font;
-            } else if (flag_italic) {
-                font = italic_font;
-            } else {
-                font = main_font;
-            }
-        } else if (codepoint == '~') {
-            if (GetCodepointNext(&text[i+1], &codepointByteCount) == '~') {
-                flag_crossed = !flag_crossed;
-                codepointByteCount += 1;
-            } else {
-                flag_wave = !flag_wave;
-            }
-        } else if (codepoint == '_' && GetCodepointNext(&text[i+1], &codepointByteCount) == '_') {
-            flag_underline = !flag_underline;
-            codepointByteCount += 1;
+            font = compiled->fonts[style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)];
+            atlas = EmotionalAtlasFor(font);
         } else {
+            int index;
+            int slot;
+            float advance = EmotionalTextAdvance(font, atlas, codepoint, scaleFactor, spacing, compiled->key.last_used, &index, &slot);
+            if (slot != -1) compiled->paged = true;
+
             if ((codepoint != ' ') && (codepoint != '\t')) {
-                float position_x;
-                float position_y;
-                position_x = position.x + textOffsetX;
-                position_y = position.y + textOffsetY;
-
-                if (flag_wave) {
-                    //Apply the wave effect
-                    position_x += sin(time*wave_x_speed-i*wave_x_offset)*wave_x_range;
-                    position_y += sin(time*wave_y_speed-i*wave_y_offset)*wave_y_range;
+                EmotionalRun *run = compiled->runCount ? &compiled->runs[compiled->runCount - 1] : NULL;
+                if (!run || run->style != style) {
+                    run = &compiled->runs[compiled->runCount++];
+                    *run = (EmotionalRun){style, compiled->glyphCount, 0};
+                    if (style & EMOTIONAL_WAVE) compiled->animated = true;
                 }
+                run->count++;
+                compiled->glyphs[compiled->glyphCount++] = (EmotionalGlyph){
+                    codepoint, index, slot, i, (Vector2){textOffsetX, (float)textOffsetY}, advance};
+            }
+
+            textOffsetX += advance;
+            if (textOffsetX > compiled->size.x) compiled->size.x = textOffsetX;
+        }
+
+        i += codepointByteCount;   // Move text bytes counter to next codepoint
+    }
+}
+
+static Rectangle EmotionalTextWhiteUV(Texture2D texture) {
+    // Center of the 3x3 white rectangle
+    return (Rectangle){(texture.width - 1.5f)/texture.width, (texture.height - 1.5f)/texture.height, 0.0f, 0.0f};
+}
 
-                DrawTextCodepoint(font, codepoint, (Vector2){ position_x, position_y }, fontSize, color);
+// Atlas and placement of a glyph, from the baked font or an atlas page
+typedef struct {
+    Texture2D texture;
+    Rectangle rec;
+    GlyphInfo info;
+} EmotionalGlyphSource;
+
+static EmotionalGlyphSource EmotionalTextGlyphSource(Font font, EmotionalGlyph glyph) {
+    if (glyph.slot == -1) return (EmotionalGlyphSource){font.texture, font.recs[glyph.index], font.glyphs[glyph.index]};
+    EmotionalAtlas *atlas = EmotionalAtlasFor(font);
+    EmotionalAtlasSlot slot = atlas->slots[glyph.slot];
+    return (EmotionalGlyphSource){EmotionalAtlasPage(atlas, glyph.slot), slot.rec, slot.info};
+}
+
+// Quads of every glyph and line, the glyphs of each atlas together
+static void EmotionalTextBuildQuads(EmotionalText *compiled) {
+    int lines = 0;
+    for (int r = 0; r < compiled->runCount; r++) {
+        if (compiled->runs[r].style & (EMOTIONAL_CROSSED | EMOTIONAL_UNDERLINE)) lines += 2*compiled->runs[r].count;
+    }
+    compiled->quads = (EmotionalQuad*)malloc((compiled->glyphCount + lines + 1)*sizeof(EmotionalQuad));
+    compiled->quadCount = 0;
+    compiled->batchCount = 0;
+
+    // One batch per atlas, the baked ones first
+    for (int f = 0; f < 4; f++) {
+        Texture2D texture = compiled->fonts[f].texture;
+        bool seen = false;
+        for (int b = 0; b < compiled->batchCount; b++) {
+            if (compiled->batches[b].texture.id == texture.id) seen = true;
+        }
+        if (!seen) compiled->batches[compiled->batchCount++] = (EmotionalBatch){texture, 0, 0};
+    }
+    for (int r = 0; r < compiled->runCount && compiled->paged; r++) {
+        EmotionalRun run = compiled->runs[r];
+        Font font = compiled->fonts[run.style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)];
+        for (int g = run.first; g < run.first + run.count; g++) {
+            if (compiled->glyphs[g].slot == -1) continue;
+            Texture2D texture = EmotionalTextGlyphSource(font, compiled->glyphs[g]).texture;
+            bool seen = false;
+            for (int b = 0; b < compiled->batchCount; b++) {
+                if (compiled->batches[b].texture.id == texture.id) seen = true;
+            }
+            if (!seen) compiled->batches[compiled->batchCount++] = (EmotionalBatch){texture, 0, 0};
+        }
+    }
+
+    float fontSize = compiled->fontSize;
+    for (int b = 0; b < compiled->batchCount; b++) {
+        EmotionalBatch *batch = &compiled->batches[b];
+        Texture2D texture = batch->texture;
+        batch->first = compiled->quadCount;
+        Rectangle white = EmotionalTextWhiteUV(texture);
+
+        for (int r = 0; r < compiled->runCount; r++) {
+            EmotionalRun run = compiled->runs[r];
+            Font font = compiled->fonts[run.style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)];
+            float scaleFactor = fontSize/font.baseSize;
+            float padding = (float)font.glyphPadding;
+
+            for (int g = run.first; g < run.first + run.count; g++) {
+                EmotionalGlyph glyph = compiled->glyphs[g];
+                EmotionalGlyphSource source = EmotionalTextGlyphSource(font, glyph);
+                if (source.texture.id != texture.id) continue;
+                Rectangle rec = source.rec;
+                GlyphInfo info = source.info;
+
+                // Same placement as DrawTextCodepoint
+                Rectangle dest = {glyph.offset.x + (info.offsetX - padding)*scaleFactor,
+                                  glyph.offset.y + (info.offsetY - padding)*scaleFactor,
+                                  (rec.width + 2.0f*padding)*scaleFactor,
+                                  (rec.height + 2.0f*padding)*scaleFactor};
+                Rectangle uv = {(rec.x - padding)/texture.width, (rec.y - padding)/texture.height,
+                                (rec.width + 2.0f*padding)/texture.width, (rec.height + 2.0f*padding)/texture.height};
+                compiled->quads[compiled->quadCount++] = (EmotionalQuad){dest, uv, g, run.style};
 
                 //Draw the crossed and underline
                 //TODO: Draw these lines over spaces when needed
-                if (flag_crossed) {
-                    DrawLine(position_x, position_y+fontSize/2,
-                             position_x + ((float)font.glyphs[index].advanceX*scaleFactor + spacing), position_y+fontSize/2,
-                             color);
+                if (run.style & EMOTIONAL_CROSSED) {
+                    Rectangle line = {glyph.offset.x, glyph.offset.y + fontSize/2, glyph.advance, 1.0f};
+                    compiled->quads[compiled->quadCount++] = (EmotionalQuad){line, white, g, run.style};
                 }
-
-                if (flag_underline) {
-                    DrawLine(position_x, position_y+fontSize,
-                             position_x + ((float)font.glyphs[index].advanceX*scaleFactor + spacing), position_y+fontSize,
-                             color);
+                if (run.style & EMOTIONAL_UNDERLINE) {
+                    Rectangle line = {glyph.offset.x, glyph.offset.y + fontSize, glyph.advance, 1.0f};
+                    compiled->quads[compiled->quadCount++] = (EmotionalQuad){line, white, g, run.style};
                 }
             }
+        }
+        batch->count = compiled->quadCount - batch->first;
+    }
+}
+
+static void EmotionalTextUnload(void *entry) {
+    EmotionalText *compiled = (EmotionalText*)entry;
+    free(compiled->text);
+    free(compiled->glyphs);
+    free(compiled->runs);
+    free(compiled->quads);
+    if (compiled->vao) {
+        rlUnloadVertexArray(compiled->vao);
+        for (int i = 0; i < 3; i++) rlUnloadVertexBuffer(compiled->vbos[i]);
+    }
+}
+
+// Two triangles per quad, with the glyph byte offset and style for the shader
+static EmotionalTextProgram* EmotionalTextProgramFor(const EmotionalText *compiled) {
+    return compiled->sdf ? &EmotionalTextGpu.sdf : &EmotionalTextGpu.bitmap;
+}
+
+static void EmotionalTextUpload(EmotionalText *compiled) {
+    int vertexCount = compiled->quadCount*6;
+    float *positions = (float*)malloc(vertexCount*3*sizeof(float));
+    float *texcoords = (float*)malloc(vertexCount*2*sizeof(float));
+    float *glyphs = (float*)malloc(vertexCount*2*sizeof(float));
+    const int corners[6][2] = {{0, 0}, {0, 1}, {1, 1}, {0, 0}, {1, 1}, {1, 0}};
+
+    for (int q = 0; q < compiled->quadCount; q++) {
+        EmotionalQuad quad = compiled->quads[q];
+        for (int c = 0; c < 6; c++) {
+            int v = q*6 + c;
+            positions[v*3] = quad.dest.x + corners[c][0]*quad.dest.width;
+            positions[v*3 + 1] = quad.dest.y + corners[c][1]*quad.dest.height;
+            positions[v*3 + 2] = 0.0f;
+            texcoords[v*2] = quad.uv.x + corners[c][0]*quad.uv.width;
+            texcoords[v*2 + 1] = quad.uv.y + corners[c][1]*quad.uv.height;
+            glyphs[v*2] = (float)compiled->glyphs[quad.glyph].source;
+            glyphs[v*2 + 1] = (float)quad.style;
+        }
+    }
+
+    EmotionalTextProgram *program = EmotionalTextProgramFor(compiled);
+    Shader shader = program->shader;
+    compiled->vao = rlLoadVertexArray();
+    rlEnableVertexArray(compiled->vao);
+    compiled->vbos[0] = rlLoadVertexBuffer(positions, vertexCount*3*sizeof(float), false);
+    rlSetVertexAttribute(shader.locs[SHADER_LOC_VERTEX_POSITION], 3, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(shader.locs[SHADER_LOC_VERTEX_POSITION]);
+    compiled->vbos[1] = rlLoadVertexBuffer(texcoords, vertexCount*2*sizeof(float), false);
+    rlSetVertexAttribute(shader.locs[SHADER_LOC_VERTEX_TEXCOORD01], 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(shader.locs[SHADER_LOC_VERTEX_TEXCOORD01]);
+    compiled->vbos[2] = rlLoadVertexBuffer(glyphs, vertexCount*2*sizeof(float), false);
+    rlSetVertexAttribute(program->locGlyph, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(program->locGlyph);
+    rlDisableVertexArray();
+
+    free(positions);
+    free(texcoords);
+    free(glyphs);
+}
+
+static EmotionalTextProgram EmotionalTextProgramLoad(Shader shader) {
+    EmotionalTextProgram program = {0};
+    program.shader = shader;
+    program.locTime = GetShaderLocation(shader, "time");
+    program.locGlyph = GetShaderLocationAttrib(shader, "vertexGlyph");
+    program.locOutlineSize = GetShaderLocation(shader, "outlineSize");
+    program.locOutlineColor = GetShaderLocation(shader, "outlineColor");
+    return program;
+}
+
+// The outline look lives in the program, the style bit picks the glyphs having it
+static void EmotionalTextProgramOutline(EmotionalTextProgram *program) {
+    if (program->locOutlineSize == -1) return;
+    Color outline = EmotionalTextGpu.outlineColor;
+    float outlineColor[4] = {outline.r/255.0f, outline.g/255.0f, outline.b/255.0f, outline.a/255.0f};
+    SetShaderValue(program->shader, program->locOutlineSize, &EmotionalTextGpu.outlineSize, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(program->shader, program->locOutlineColor, outlineColor, SHADER_UNIFORM_VEC4);
+}
+
+// Moves the quads to the GPU, the shader takes over the animated styles
+void SetEmotionalTextShader(Shader shader) {
+    EmotionalTextGpu.bitmap = EmotionalTextProgramLoad(shader);
+}
+
+// Program for the distance field fonts
+void SetEmotionalTextSdfShader(Shader shader) {
+    EmotionalTextGpu.sdf = EmotionalTextProgramLoad(shader);
+    EmotionalTextProgramOutline(&EmotionalTextGpu.sdf);
+}
+
+// Texts in this font are drawn with the distance field program
+void SetEmotionalTextFontSdf(Font font) {
+    if (EmotionalTextGpu.sdfCount == EMOTIONAL_SDF_FONTS_MAX) {
+        TraceLog(LOG_WARNING, "EMOTIONAL: Too many SDF fonts, font %i drawn as a bitmap", font.texture.id);
+        return;
+    }
+    EmotionalTextGpu.sdfTextures[EmotionalTextGpu.sdfCount++] = font.texture.id;
+}
+
+// Outline of the ^^outline^^ style, size in distance units (0.0 to 0.5)
+void SetEmotionalTextOutline(float size, Color color) {
+    EmotionalTextGpu.outlineSize = size;
+    EmotionalTextGpu.outlineColor = color;
+    if (EmotionalTextGpu.sdf.shader.id) EmotionalTextProgramOutline(&EmotionalTextGpu.sdf);
+}
+
+// Codepoints missing from the font are drawn from the first file of the chain
+// having them, usually the font own file then broader ones. Call it after
+// SetEmotionalTextFontSdf for a distance field font.
+void SetEmotionalTextFontChain(Font font, const char **paths, int count) {
+    if (EmotionalTextAtlases.count == EMOTIONAL_CHAIN_FONTS_MAX) {
+        TraceLog(LOG_WARNING, "EMOTIONAL: Too many font chains, font %i drawn as baked", font.texture.id);
+        return;
+    }
+
+    EmotionalAtlas *atlas = &EmotionalTextAtlases.entries[EmotionalTextAtlases.count];
+    *atlas = (EmotionalAtlas){0};
+    atlas->fontTexture = font.texture.id;
+    atlas->baseSize = font.baseSize;
+    atlas->padding = font.glyphPadding;
+    atlas->type = FONT_DEFAULT;
+    for (int i = 0; i < EmotionalTextGpu.sdfCount; i++) {
+        if (EmotionalTextGpu.sdfTextures[i] == font.texture.id) atlas->type = FONT_SDF;
+    }
+    for (int i = 0; i < count && atlas->faceCount < EMOTIONAL_CHAIN_FACES_MAX; i++) {
+        EmotionalFace face = {0};
+        face.data = LoadFileData(paths[i], &face.size);
+        if (face.data) face.cmap = EmotionalFaceFindCmap(face.data, face.size);
+        if (face.cmap == 0) {
+            TraceLog(LOG_WARNING, "EMOTIONAL: No unicode cmap in %s, left out of the chain", paths[i]);
+            UnloadFileData(face.data);
+            continue;
+        }
+        atlas->faces[atlas->faceCount++] = face;
+    }
+
+    // Room for the glyphs taller than the size, as raylib warns about
+    atlas->cell = atlas->baseSize*3/2 + 2*atlas->padding + 2;
+    atlas->cellsPerRow = EMOTIONAL_ATLAS_PAGE_SIZE/atlas->cell;
+    atlas->slotsPerPage = atlas->cellsPerRow*atlas->cellsPerRow - 1;
+    atlas->slots = (EmotionalAtlasSlot*)calloc(atlas->slotsPerPage*EMOTIONAL_ATLAS_PAGES_MAX, sizeof(EmotionalAtlasSlot));
+    for (int i = 0; i < EMOTIONAL_ATLAS_BUCKETS; i++) atlas->buckets[i] = -1;
+    EmotionalTextAtlases.count++;
+}
+
+// Frees every compiled text and glyph atlas, before the window is closed
+void UnloadEmotionalTextCache(void) {
+    lru_clear(&EmotionalTextCache.lru, EmotionalTextUnload);
+    for (int i = 0; i < EmotionalTextAtlases.count; i++) {
+        EmotionalAtlasUnload(&EmotionalTextAtlases.entries[i]);
+    }
+    EmotionalTextAtlases.count = 0;
+}
+
+// What a text is compiled from
+typedef struct {
+    const Font *fonts;
+    const char *text;
+    float fontSize;
+    float spacing;
+    float linespacing;
+} EmotionalTextSource;
+
+// Same text and layout, a hash match alone may be a collision
+static bool EmotionalTextMatches(const void *entry, const void *key) {
+    const EmotionalText *compiled = (const EmotionalText*)entry;
+    const EmotionalTextSource *source = (const EmotionalTextSource*)key;
+    for (int i = 0; i < 4; i++) {
+        if (compiled->fonts[i].texture.id != source->fonts[i].texture.id || compiled->fonts[i].baseSize != source->fonts[i].baseSize) return false;
+    }
+    return compiled->fontSize == source->fontSize && compiled->spacing == source->spacing &&
+           compiled->linespacing == source->linespacing && strcmp(compiled->text, source->text) == 0;
+}
+
+// Marks the atlas glyphs of the text used, false when one was replaced since
+static bool EmotionalTextTouch(EmotionalText *compiled, unsigned long tick) {
+    for (int r = 0; r < compiled->runCount; r++) {
+        EmotionalRun run = compiled->runs[r];
+        EmotionalAtlas *atlas = EmotionalAtlasFor(compiled->fonts[run.style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)]);
+        for (int g = run.first; g < run.first + run.count; g++) {
+            EmotionalGlyph glyph = compiled->glyphs[g];
+            if (glyph.slot == -1) continue;
+            if (atlas->slots[glyph.slot].codepoint != glyph.codepoint) return false;
+            atlas->slots[glyph.slot].lastUsed = tick;
+        }
+    }
+    return true;
+}
+
+// The compiled text stays valid until EMOTIONAL_TEXT_CACHE_SIZE other texts are compiled,
+// or, with glyphs from an atlas page, until the next compile
+EmotionalText* CompileEmotionalText(Font main_font, Font italic_font,
+                                    Font bold_font, Font bolditalic_font,
+                                    const char *text,
+                                    float fontSize,
+                                    float spacing,
+                                    float linespacing) {
+    Font fonts[4] = {main_font, italic_font, bold_font, bolditalic_font};
+    EmotionalTextSource source = {fonts, text, fontSize, spacing, linespacing};
+    unsigned long long hash = EmotionalTextHash(fonts, text, fontSize, spacing, linespacing);
+    Lru *lru = &EmotionalTextCache.lru;
+
+    EmotionalText *entry = (EmotionalText*)lru_find(lru, hash, EmotionalTextMatches, &source);
+    if (entry && (!entry->paged || EmotionalTextTouch(entry, lru->tick))) {
+        EmotionalTextCache.hits++;
+        return entry;
+    }
+    if (entry) {
+        // Compiled again, over the atlas glyphs it lost
+        lru_reset(lru, entry, hash, EmotionalTextUnload);
+    } else {
+        entry = (EmotionalText*)lru_insert(lru, hash, EmotionalTextUnload);
+    }
+    EmotionalTextCache.misses++;
+
+    size_t length = strlen(text);
+    entry->text = (char*)malloc(length + 1);
+    memcpy(entry->text, text, length + 1);
+    memcpy(entry->fonts, fonts, sizeof(fonts));
+    entry->fontSize = fontSize;
+    entry->spacing = spacing;
+    entry->linespacing = linespacing;
+    for (int i = 0; i < EmotionalTextGpu.sdfCount; i++) {
+        if (EmotionalTextGpu.sdfTextures[i] == main_font.texture.id) entry->sdf = true;
+    }
+    EmotionalTextParse(entry, text, spacing, linespacing);
+    EmotionalTextBuildQuads(entry);
+    return entry;
+}
+
+// Quads of the batch belonging to the first glyphs, batches keep the glyph order
+static int EmotionalBatchRevealed(const EmotionalText *compiled, EmotionalBatch batch, int glyphs) {
+    int low = 0;
+    int high = batch.count;
+    while (low < high) {
+        int middle = (low + high)/2;
+        if (compiled->quads[batch.first + middle].glyph < glyphs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void EmotionalTextDrawGpu(EmotionalText *compiled, Vector2 position, int glyphs, float time, Color color) {
+    if (!compiled->vao) EmotionalTextUpload(compiled);
+
+    // Whatever was drawn before goes first
+    rlDrawRenderBatchActive();
+
+    EmotionalTextProgram *program = EmotionalTextProgramFor(compiled);
+    Shader shader = program->shader;
+    Matrix model = MatrixMultiply(MatrixTranslate(position.x, position.y, 0.0f), rlGetMatrixTransform());
+    Matrix mvp = MatrixMultiply(MatrixMultiply(model, rlGetMatrixModelview()), rlGetMatrixProjection());
+    float diffuse[4] = {color.r/255.0f, color.g/255.0f, color.b/255.0f, color.a/255.0f};
+    int slot = 0;
+
+    float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    rlEnableShader(shader.id);
+    // The quads have no colour, the rlgl batch ones do
+    if (shader.locs[SHADER_LOC_VERTEX_COLOR] != -1) {
+        rlSetVertexAttributeDefault(shader.locs[SHADER_LOC_VERTEX_COLOR], white, RL_SHADER_ATTRIB_VEC4, 4);
+    }
+    rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+    rlSetUniform(shader.locs[SHADER_LOC_COLOR_DIFFUSE], diffuse, RL_SHADER_UNIFORM_VEC4, 1);
+    rlSetUniform(shader.locs[SHADER_LOC_MAP_DIFFUSE], &slot, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(program->locTime, &time, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlEnableVertexArray(compiled->vao);
+    rlActiveTextureSlot(0);
+
+    for (int b = 0; b < compiled->batchCount; b++) {
+        EmotionalBatch batch = compiled->batches[b];
+        int count = EmotionalBatchRevealed(compiled, batch, glyphs);
+        if (count == 0) continue;
+        rlEnableTexture(batch.texture.id);
+        rlDrawVertexArray(batch.first*6, count*6);
+    }
+
+    rlDisableTexture();
+    rlDisableVertexArray();
+    rlDisableShader();
+}
+
+// Styles the distance field program draws, the rlgl batch has no attribute for
+// them so they are the default value of the glyph attribute
+#define EMOTIONAL_SDF_STYLES (EMOTIONAL_BOLD | EMOTIONAL_OUTLINE)
+
+static void EmotionalTextSetBatchStyle(const EmotionalTextProgram *program, int style) {
+    float glyph[2] = {0.0f, (float)style};
+    if (program->locGlyph != -1) rlSetVertexAttributeDefault(program->locGlyph, glyph, RL_SHADER_ATTRIB_VEC2, 2);
+}
+
+// With a distance field program the batch is drawn with it, flushed whenever
+// the style it reads changes
+static void EmotionalTextDrawImmediate(const EmotionalText *compiled, const EmotionalTextProgram *program, Vector2 position, int glyphs, float time, Color color) {
+    int programStyle = 0;
+    if (program) {
+        BeginShaderMode(program->shader);
+        EmotionalTextSetBatchStyle(program, programStyle);
+    }
+
+    for (int b = 0; b < compiled->batchCount; b++) {
+        EmotionalBatch batch = compiled->batches[b];
+        int count = EmotionalBatchRevealed(compiled, batch, glyphs);
+        if (count == 0) continue;
 
-            if (font.glyphs[index].advanceX == 0) {
-                textOffsetX += ((float)font.recs[index].width*scaleFactor + spacing);
-            } else {
-                textOffsetX += ((float)font.glyphs[index].advanceX*scaleFactor + spacing);
+        // The whole batch goes to the same rlgl draw
+        rlSetTexture(batch.texture.id);
+        rlBegin(RL_QUADS);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+
+        for (int q = batch.first; q < batch.first + count; q++) {
+            EmotionalQuad quad = compiled->quads[q];
+            if (program && (quad.style & EMOTIONAL_SDF_STYLES) != programStyle) {
+                rlEnd();
+                rlDrawRenderBatchActive();
+                programStyle = quad.style & EMOTIONAL_SDF_STYLES;
+                EmotionalTextSetBatchStyle(program, programStyle);
+                rlBegin(RL_QUADS);
+                rlColor4ub(color.r, color.g, color.b, color.a);
+                rlNormal3f(0.0f, 0.0f, 1.0f);
+            }
+            float position_x = position.x + quad.dest.x;
+            float position_y = position.y + quad.dest.y;
+
+            if (quad.style & EMOTIONAL_WAVE) {
+                //Apply the wave effect
+                int source = compiled->glyphs[quad.glyph].source;
+                position_x += sin(time*EMOTIONAL_WAVE_X_SPEED-source*EMOTIONAL_WAVE_X_OFFSET)*EMOTIONAL_WAVE_X_RANGE;
+                position_y += sin(time*EMOTIONAL_WAVE_Y_SPEED-source*EMOTIONAL_WAVE_Y_OFFSET)*EMOTIONAL_WAVE_Y_RANGE;
             }
+
+            float right = position_x + quad.dest.width;
+            float bottom = position_y + quad.dest.height;
+            float uv_right = quad.uv.x + quad.uv.width;
+            float uv_bottom = quad.uv.y + quad.uv.height;
+            rlTexCoord2f(quad.uv.x, quad.uv.y);
+            rlVertex2f(position_x, position_y);
+            rlTexCoord2f(quad.uv.x, uv_bottom);
+            rlVertex2f(position_x, bottom);
+            rlTexCoord2f(uv_right, uv_bottom);
+            rlVertex2f(right, bottom);
+            rlTexCoord2f(uv_right, quad.uv.y);
+            rlVertex2f(right, position_y);
         }
 
-        i += codepointByteCount;   // Move text bytes counter to next codepoint
+        rlEnd();
+        rlSetTexture(0);
     }
+
+    if (program) EndShaderMode();
+}
+
+// Only the first glyphs, for a typewriter effect over the laid out text
+void DrawEmotionalTextRevealed(EmotionalText* compiled, Vector2 position, int glyphs, float time, Color color) {
+    EmotionalTextProgram *program = EmotionalTextProgramFor(compiled);
+    if (!program->shader.id) {
+        EmotionalTextDrawImmediate(compiled, NULL, position, glyphs, time, color);
+    } else if (compiled->vao || compiled->animated || compiled->draws >= EMOTIONAL_TEXT_UPLOAD_DRAWS) {
+        EmotionalTextDrawGpu(compiled, position, glyphs, time, color);
+    } else {
+        // Until it is drawn often enough to pay for its buffers
+        compiled->draws++;
+        EmotionalTextDrawImmediate(compiled, compiled->sdf ? program : NULL, position, glyphs, time, color);
+    }
+}
+
+void DrawEmotionalTextCompiled(EmotionalText* compiled, Vector2 position, float time, Color color) {
+    DrawEmotionalTextRevealed(compiled, position, compiled->glyphCount, time, color);
+}
+
+void DrawEmotionalTextEx(Font main_font, Font italic_font,
+                         Font bold_font, Font bolditalic_font,
+                         const char *text,
+                         Vector2 position,
+                         float fontSize,
+                         float spacing,
+                         float linespacing,
+                         float time,Color color) {
+    EmotionalText *compiled = CompileEmotionalText(main_font, italic_font, bold_font, bolditalic_font,
+                                                   text, fontSize, spacing, linespacing);
+    DrawEmotionalTextCompiled(compiled, position, time, color);
+}
+
+// Drawn like DrawEmotionalTextReveal, wrapped at the flow width
+void DrawEmotionalFlow(EmotionalFlow *flow, Vector2 position, int glyphs, float time, Color color) {
+    EmotionalText *compiled = CompileEmotionalText(flow->fonts[0], flow->fonts[1], flow->fonts[2], flow->fonts[3],
+                                                   flow->wrapped, flow->fontSize, flow->spacing, flow->linespacing);
+    DrawEmotionalTextRevealed(compiled, position, glyphs, time, color);
+}
+
+EmotionalFlow LoadEmotionalFlow(Font main_font, Font italic_font,
+                                Font bold_font, Font bolditalic_font,
+                                float fontSize,
+                                float spacing,
+                                float linespacing,
+                                float width) {
+    EmotionalFlow flow = {0};
+    flow.fonts[0] = main_font;
+    flow.fonts[1] = italic_font;
+    flow.fonts[2] = bold_font;
+    flow.fonts[3] = bolditalic_font;
+    flow.fontSize = fontSize;
+    flow.spacing = spacing;
+    flow.linespacing = linespacing;
+    flow.width = width;
+    AppendEmotionalFlow(&flow, "");
+    return flow;
+}
+
+void UnloadEmotionalFlow(EmotionalFlow *flow) {
+    free(flow->text);
+    free(flow->wrapped);
+    free(flow->words);
+    free(flow->lines);
+    *flow = (EmotionalFlow){0};
+}
+
+static void EmotionalFlowPushWord(EmotionalFlow *flow, EmotionalWord word) {
+    if (flow->wordCount == flow->wordCapacity) {
+        flow->wordCapacity = flow->wordCapacity ? flow->wordCapacity*2 : 64;
+        flow->words = (EmotionalWord*)realloc(flow->words, flow->wordCapacity*sizeof(EmotionalWord));
+    }
+    flow->words[flow->wordCount++] = word;
+}
+
+// Splits the text from a word start into words, measured in the font of their style
+static void EmotionalFlowMeasure(EmotionalFlow *flow, int from, int style) {
+    const char *text = flow->text;
+    float scaleFactor = flow->fontSize/flow->fonts[0].baseSize;
+    unsigned long tick = ++EmotionalTextCache.lru.tick;
+    Font font = flow->fonts[style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)];
+    EmotionalAtlas *atlas = EmotionalAtlasFor(font);
+    int index;
+    int slot;
+
+    for (int i = from; i < flow->length;) {
+        EmotionalWord word = {i, 0, 0, style, 0.0f, 0.0f, false};
+        while ((i < flow->length) && (text[i] != ' ') && (text[i] != '\t') && (text[i] != '\n')) {
+            int markupByteCount = EmotionalTextMarkup(&text[i], &style);
+            if (markupByteCount > 0) {
+                i += markupByteCount;
+                font = flow->fonts[style & (EMOTIONAL_ITALIC | EMOTIONAL_BOLD)];
+                atlas = EmotionalAtlasFor(font);
+                continue;
+            }
+            int codepointByteCount = 0;
+            int codepoint = GetCodepointNext(&text[i], &codepointByteCount);
+            if (codepoint == 0x3f) codepointByteCount = 1;
+            word.width += EmotionalTextAdvance(font, atlas, codepoint, scaleFactor, flow->spacing, tick, &index, &slot);
+            i += codepointByteCount;
+        }
+        word.length = i - word.start;
+
+        while ((i < flow->length) && ((text[i] == ' ') || (text[i] == '\t'))) {
+            word.space += EmotionalTextAdvance(font, atlas, text[i], scaleFactor, flow->spacing, tick, &index, &slot);
+            i++;
+        }
+        if ((i < flow->length) && (text[i] == '\n')) {
+            word.newline = true;
+            i++;
+        }
+        word.separator = i - word.start - word.length;
+        EmotionalFlowPushWord(flow, word);
+    }
+}
+
+static EmotionalLine* EmotionalFlowPushLine(EmotionalFlow *flow, int word, int wrapped) {
+    flow->lines[flow->lineCount] = (EmotionalLine){word, wrapped, 0.0f};
+    return &flow->lines[flow->lineCount++];
+}
+
+// Greedy wrapping from the line holding the word, the lines before it stay
+static void EmotionalFlowWrap(EmotionalFlow *flow, int from) {
+    int line = flow->lineCount - 1;
+    while ((line > 0) && (flow->lines[line].word > from)) line--;
+    // The word may now fit at the end of the line before
+    if (line > 0) line--;
+    int w = (line > 0) ? flow->lines[line].word : 0;
+    int out = (line > 0) ? flow->lines[line].wrapped : 0;
+    flow->lineCount = (line > 0) ? line : 0;
+
+    // Never more lines than words plus one, nor wrapped bytes than text bytes
+    if (flow->lineCapacity < flow->wordCount + 1) {
+        flow->lineCapacity = flow->wordCount*2 + 1;
+        flow->lines = (EmotionalLine*)realloc(flow->lines, flow->lineCapacity*sizeof(EmotionalLine));
+    }
+    if (flow->wrappedCapacity < flow->length + 1) {
+        flow->wrappedCapacity = flow->textCapacity;
+        flow->wrapped = (char*)realloc(flow->wrapped, flow->wrappedCapacity);
+    }
+
+    EmotionalLine *current = EmotionalFlowPushLine(flow, w, out);
+    float x = 0.0f;
+    for (; w < flow->wordCount; w++) {
+        EmotionalWord word = flow->words[w];
+        if ((w > current->word) && (x + word.width > flow->width)) {
+            // The spaces before the word become the line break
+            out -= flow->words[w - 1].separator;
+            flow->wrapped[out++] = '\n';
+            current = EmotionalFlowPushLine(flow, w, out);
+            x = 0.0f;
+        }
+        memcpy(&flow->wrapped[out], &flow->text[word.start], word.length + word.separator);
+        out += word.length + word.separator;
+        current->width = x + word.width;
+        x += word.width + word.space;
+        if (word.newline) {
+            current = EmotionalFlowPushLine(flow, w + 1, out);
+            x = 0.0f;
+        }
+    }
+    flow->wrapped[out] = '\0';
+    flow->wrappedLength = out;
+}
+
+// Only the last word and what follows are measured, only its line and the next ones wrapped
+void AppendEmotionalFlow(EmotionalFlow *flow, const char *text) {
+    int length = TextLength(text);
+    if (flow->textCapacity < flow->length + length + 1) {
+        flow->textCapacity = (flow->length + length)*2 + 1;
+        flow->text = (char*)realloc(flow->text, flow->textCapacity);
+    }
+    memcpy(&flow->text[flow->length], text, length + 1);
+    flow->length += length;
+
+    // The last word may go on in the new text
+    int word = (flow->wordCount > 0) ? flow->wordCount - 1 : 0;
+    int from = (flow->wordCount > 0) ? flow->words[word].start : 0;
+    int style = (flow->wordCount > 0) ? flow->words[word].style : 0;
+    flow->wordCount = word;
+    EmotionalFlowMeasure(flow, from, style);
+    EmotionalFlowWrap(flow, word);
+}
+
+// Wrapped again from the measured words
+void SetEmotionalFlowWidth(EmotionalFlow *flow, float width) {
+    if (flow->width == width) return;
+    flow->width = width;
+    EmotionalFlowWrap(flow, 0);
 }
 
 void UpdateEmotionalTextTimer()
@@ -0,0 +1,172 @@
+#include "font_cache.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "hash.h"
+
+#define DEFAULT_GLYPHS 95
+
+static uint64_t font_cache_key(const char* path, int size, int* codepoints, int count, int type) {
+    uint64_t key = hash_string(HASH_OFFSET, path);
+    key          = hash_bytes(key, &size, sizeof(size));
+    key          = hash_bytes(key, &type, sizeof(type));
+    key          = hash_bytes(key, &count, sizeof(count));
+    if (codepoints) {
+        key = hash_bytes(key, codepoints, count * sizeof(int));
+    }
+    return key;
+}
+
+static uint64_t ttf_hash(const unsigned char* data, int size) {
+    return hash_bytes(HASH_OFFSET, data, size);
+}
+
+static bool font_cache_read(const char* cache_path, uint64_t key, struct stat ttf, const unsigned char** ttf_data,
+                            int* ttf_data_size, const char* path, Font* font, Image* atlas) {
+    if (!FileExists(cache_path)) {
+        return false;
+    }
+    int            size = 0;
+    unsigned char* data = LoadFileData(cache_path, &size);
+    if (!data) {
+        return false;
+    }
+
+    FontCacheHeader header = {0};
+    bool            valid  = (size_t)size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, data, sizeof(header));
+        valid = (memcmp(header.magic, FONT_CACHE_MAGIC, sizeof(header.magic)) == 0) &&
+                (header.version == FONT_CACHE_VERSION) && (header.key == key) && (header.glyph_count > 0) &&
+                ((size_t)size == sizeof(header) + header.glyph_count * sizeof(FontCacheGlyph) + header.atlas_size);
+    }
+    // a touched but unchanged TTF keeps its cache
+    if (valid && ((header.ttf_mtime != (int64_t)ttf.st_mtime) || (header.ttf_size != (uint64_t)ttf.st_size))) {
+        if (!*ttf_data) {
+            *ttf_data = LoadFileData(path, ttf_data_size);
+        }
+        valid = *ttf_data && (header.ttf_hash == ttf_hash(*ttf_data, *ttf_data_size));
+    }
+    if (!valid) {
+        UnloadFileData(data);
+        return false;
+    }
+
+    FontCacheGlyph* glyphs = (FontCacheGlyph*)(data + sizeof(header));
+    *font                  = (Font){0};
+    font->baseSize         = header.base_size;
+    font->glyphCount       = header.glyph_count;
+    font->glyphPadding     = header.glyph_padding;
+    font->glyphs           = (GlyphInfo*)calloc(header.glyph_count, sizeof(GlyphInfo));
+    font->recs             = (Rectangle*)calloc(header.glyph_count, sizeof(Rectangle));
+    for (int i = 0; i < header.glyph_count; i++) {
+        font->glyphs[i] = (GlyphInfo){glyphs[i].value, glyphs[i].offset_x, glyphs[i].offset_y, glyphs[i].advance_x};
+        font->recs[i]   = (Rectangle){glyphs[i].rec[0], glyphs[i].rec[1], glyphs[i].rec[2], glyphs[i].rec[3]};
+    }
+
+    *atlas         = (Image){0};
+    atlas->data    = malloc(header.atlas_size);
+    atlas->width   = header.atlas_width;
+    atlas->height  = header.atlas_height;
+    atlas->mipmaps = 1;
+    atlas->format  = header.atlas_format;
+    memcpy(atlas->data, data + sizeof(header) + header.glyph_count * sizeof(FontCacheGlyph), header.atlas_size);
+    UnloadFileData(data);
+    return true;
+}
+
+static void font_cache_write(const char* cache_path, FontCacheHeader header, Font font, Image atlas) {
+    if ((mkdir("build", 0755) != 0 && errno != EEXIST) || (mkdir(FONT_CACHE_DIR, 0755) != 0 && errno != EEXIST)) {
+        printf("[ERROR] Could not create the font cache directory: %s\n", FONT_CACHE_DIR);
+        return;
+    }
+    FILE* f = fopen(cache_path, "wb");
+    if (!f) {
+        printf("[ERROR] Could not write the font cache: %s\n", cache_path);
+        return;
+    }
+
+    header.atlas_width  = atlas.width;
+    header.atlas_height = atlas.height;
+    header.atlas_format = atlas.format;
+    header.atlas_size   = GetPixelDataSize(atlas.width, atlas.height, atlas.format);
+    fwrite(&header, sizeof(header), 1, f);
+    for (int i = 0; i < font.glyphCount; i++) {
+        GlyphInfo      info  = font.glyphs[i];
+        Rectangle      rec   = font.recs[i];
+        FontCacheGlyph glyph = {info.value, info.offsetX, info.offsetY, info.advanceX, {rec.x, rec.y, rec.width, rec.height}};
+        fwrite(&glyph, sizeof(glyph), 1, f);
+    }
+    fwrite(atlas.data, header.atlas_size, 1, f);
+    fclose(f);
+}
+
+// Glyphs and atlas image of the font, from the cache or rasterized and saved
+void font_cache_decode(const char* path, int size, int* codepoints, int count, int type, Font* out, Image* atlas) {
+    struct stat ttf;
+    if (stat(path, &ttf) != 0) {
+        printf("[ERROR] Could not find the font: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    // like LoadFontEx, without codepoints the first count from the space
+    count = (codepoints || (count > 0)) ? count : DEFAULT_GLYPHS;
+
+    uint64_t key = font_cache_key(path, size, codepoints, count, type);
+    char     cache_path[256];
+    snprintf(cache_path, sizeof(cache_path), "%s/%016llx.rlfc", FONT_CACHE_DIR, (unsigned long long)key);
+
+    const unsigned char* ttf_data      = NULL;
+    int                  ttf_data_size = 0;
+    Font                 font          = {0};
+    if (font_cache_read(cache_path, key, ttf, &ttf_data, &ttf_data_size, path, &font, atlas)) {
+        UnloadFileData((unsigned char*)ttf_data);
+        *out = font;
+        return;
+    }
+
+    // rasterize as LoadFontEx does, keeping the atlas image to save it
+    if (!ttf_data) {
+        ttf_data = LoadFileData(path, &ttf_data_size);
+    }
+    if (!ttf_data) {
+        printf("[ERROR] Could not load the font: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    int padding       = type == FONT_SDF ? 0 : FONT_CACHE_PADDING;
+    font.baseSize     = size;
+    font.glyphCount   = count;
+    font.glyphPadding = padding;
+    font.glyphs       = LoadFontData(ttf_data, ttf_data_size, size, codepoints, count, type);
+    if (!font.glyphs) {
+        printf("[ERROR] Could not rasterize the font: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    *atlas = GenImageFontAtlas(font.glyphs, &font.recs, count, size, padding, type == FONT_SDF ? 1 : 0);
+
+    FontCacheHeader header = {0};
+    memcpy(header.magic, FONT_CACHE_MAGIC, sizeof(header.magic));
+    header.version       = FONT_CACHE_VERSION;
+    header.key           = key;
+    header.ttf_mtime     = ttf.st_mtime;
+    header.ttf_size      = ttf.st_size;
+    header.ttf_hash      = ttf_hash(ttf_data, ttf_data_size);
+    header.base_size     = size;
+    header.glyph_count   = count;
+    header.glyph_padding = padding;
+    header.type          = type;
+    font_cache_write(cache_path, header, font, *atlas);
+    printf("[INFO] Font cache rebuilt: %s %d -> %s\n", path, size, cache_path);
+
+    UnloadFileData((unsigned char*)ttf_data);
+    *out = font;
+}
+
+Font font_cache_load(const char* path, int size, int* codepoints, int count, int type) {
+    Font  font  = {0};
+    Image atlas = {0};
+    font_cache_decode(path, size, codepoints, count, type, &font, &atlas);
+    font.texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    return font;
+}
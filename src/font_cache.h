@@ -0,0 +1,49 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "raylib.h"
+
+typedef struct FontCacheHeader FontCacheHeader;
+typedef struct FontCacheGlyph FontCacheGlyph;
+
+#define FONT_CACHE_MAGIC "RLFC"
+#define FONT_CACHE_VERSION 1
+#define FONT_CACHE_DIR "build/fonts"
+#define FONT_CACHE_PADDING 4 // same glyph padding as LoadFontEx
+
+// Font atlas file: this header, glyph_count glyphs, then the atlas pixels
+// (atlas_size bytes of atlas_format). One file per key, the FNV-1a hash of
+// the font path, size, type and codepoints. The file is stale when the TTF
+// size and mtime changed and its contents hash changed too.
+struct FontCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    int64_t ttf_mtime;
+    uint64_t ttf_size;
+    uint64_t ttf_hash;
+    int32_t base_size;
+    int32_t glyph_count;
+    int32_t glyph_padding;
+    int32_t type;
+    int32_t atlas_width;
+    int32_t atlas_height;
+    int32_t atlas_format;
+    uint32_t atlas_size;
+};
+
+struct FontCacheGlyph {
+    int32_t value;
+    int32_t offset_x;
+    int32_t offset_y;
+    int32_t advance_x;
+    float rec[4];
+};
+
+// LoadFontEx through the cache, type FONT_DEFAULT or FONT_SDF. codepoints
+// NULL means count glyphs from the space, the 95 ASCII ones when count is 0.
+// The atlas is rasterized and saved when there is no valid cache file.
+Font font_cache_load(const char* path, int size, int* codepoints, int count, int type);
+// font_cache_load without the texture upload, safe off the main thread
+void font_cache_decode(const char* path, int size, int* codepoints, int count, int type, Font* font, Image* atlas);
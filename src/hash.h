@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// FNV-1a, fast enough for cache keys and file checks, not for anything adversarial
+#define HASH_OFFSET 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+#define HASH32_OFFSET 2166136261u
+#define HASH32_PRIME 16777619u
+
+// hash continued over size bytes of data, start from HASH_OFFSET
+static inline uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * HASH_PRIME;
+    }
+    return hash;
+}
+
+// without the NUL, so a string and its bytes hash the same
+static inline uint64_t hash_string(uint64_t hash, const char* text) {
+    return hash_bytes(hash, text, strlen(text));
+}
+
+// 32 bit variant, kept for the checksums already stored in files
+static inline uint32_t hash32_bytes(uint32_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * HASH32_PRIME;
+    }
+    return hash;
+}
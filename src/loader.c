@@ -0,0 +1,182 @@
+#include "loader.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "font_cache.h"
+
+Loader* loader_new(void) {
+    Loader* loader = (Loader*)calloc(1, sizeof(Loader));
+    atomic_init(&loader->next, 0);
+    pthread_mutex_init(&loader->mutex, NULL);
+    pthread_cond_init(&loader->decoded, NULL);
+    return loader;
+}
+
+static LoaderJob* loader_add(Loader* loader, LoaderKind kind, void* target, const char* path) {
+    if (loader->count >= loader->capacity) {
+        loader->capacity = loader->capacity ? loader->capacity * 2 : LOADER_JOBS_INITIAL_CAPACITY;
+        loader->jobs     = (LoaderJob*)realloc(loader->jobs, loader->capacity * sizeof(LoaderJob));
+    }
+    LoaderJob* job = &loader->jobs[loader->count++];
+    *job           = (LoaderJob){0};
+    job->kind      = kind;
+    job->path      = path;
+    job->target    = target;
+    atomic_init(&job->decoded, false);
+    return job;
+}
+
+void loader_add_image(Loader* loader, Image* image, const char* path) {
+    loader_add(loader, LOADER_IMAGE, image, path);
+}
+
+void loader_add_texture(Loader* loader, Texture2D* texture, const char* path) {
+    loader_add(loader, LOADER_TEXTURE, texture, path);
+}
+
+void loader_add_model(Loader* loader, Model* model, const char* obj_path) {
+    loader_add(loader, LOADER_MODEL, model, obj_path);
+}
+
+void loader_add_meshes(Loader* loader, MeshCacheModel* model, const char* obj_path) {
+    loader_add(loader, LOADER_MESHES, model, obj_path);
+}
+
+// font_cache_load arguments, NULL codepoints: glyphs from the space, 0 for ASCII
+void loader_add_font(Loader* loader, Font* font, const char* path, int size, int glyphs, int type) {
+    LoaderJob* job   = loader_add(loader, LOADER_FONT, font, path);
+    job->font_size   = size;
+    job->font_glyphs = glyphs;
+    job->font_type   = type;
+}
+
+void loader_add_sound(Loader* loader, Sound* sound, const char* path) {
+    loader_add(loader, LOADER_SOUND, sound, path);
+}
+
+// worker side, no GPU or audio device calls
+static void loader_decode(LoaderJob* job) {
+    switch (job->kind) {
+    case LOADER_IMAGE:
+    case LOADER_TEXTURE:
+        job->image = LoadImage(job->path);
+        break;
+    case LOADER_MODEL:
+        mesh_cache_decode(job->path, &job->model);
+        break;
+    case LOADER_MESHES:
+        mesh_cache_get(job->path, &job->model);
+        break;
+    case LOADER_FONT:
+        font_cache_decode(job->path, job->font_size, NULL, job->font_glyphs, job->font_type, &job->font, &job->image);
+        break;
+    case LOADER_SOUND:
+        job->wave = LoadWave(job->path);
+        break;
+    }
+}
+
+static void loader_upload(LoaderJob* job) {
+    switch (job->kind) {
+    case LOADER_IMAGE:
+        *(Image*)job->target = job->image;
+        break;
+    case LOADER_TEXTURE:
+        *(Texture2D*)job->target = LoadTextureFromImage(job->image);
+        UnloadImage(job->image);
+        break;
+    case LOADER_MODEL:
+        *(Model*)job->target = mesh_cache_upload(&job->model);
+        break;
+    case LOADER_MESHES:
+        *(MeshCacheModel*)job->target = job->model;
+        break;
+    case LOADER_FONT:
+        job->font.texture   = LoadTextureFromImage(job->image);
+        *(Font*)job->target = job->font;
+        UnloadImage(job->image);
+        break;
+    case LOADER_SOUND:
+        *(Sound*)job->target = LoadSoundFromWave(job->wave);
+        UnloadWave(job->wave);
+        break;
+    }
+}
+
+static void* loader_worker(void* arg) {
+    Loader* loader = (Loader*)arg;
+    for (;;) {
+        int i = atomic_fetch_add(&loader->next, 1);
+        if (i >= loader->count) {
+            return NULL;
+        }
+        loader_decode(&loader->jobs[i]);
+
+        pthread_mutex_lock(&loader->mutex);
+        atomic_store(&loader->jobs[i].decoded, true);
+        pthread_cond_signal(&loader->decoded);
+        pthread_mutex_unlock(&loader->mutex);
+    }
+}
+
+// Loads every queued file and returns when all targets are filled. One
+// worker per core, the calling thread, which owns the GL context, uploads.
+void loader_run(Loader* loader, LoaderProgress progress, void* user) {
+    long cores           = sysconf(_SC_NPROCESSORS_ONLN);
+    loader->worker_count = cores < 1 ? 1 : (cores > LOADER_THREADS_MAX ? LOADER_THREADS_MAX : (int)cores);
+    loader->worker_count = loader->worker_count < loader->count ? loader->worker_count : loader->count;
+    for (int i = 0; i < loader->worker_count; i++) {
+        if (pthread_create(&loader->workers[i], NULL, loader_worker, loader) != 0) {
+            printf("[ERROR] Could not start the loader thread %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (progress) {
+        progress(0, loader->count, user);
+    }
+    bool* uploaded = (bool*)calloc(loader->count > 0 ? loader->count : 1, sizeof(bool));
+    int   loaded   = 0;
+    while (loaded < loader->count) {
+        bool any = false;
+        for (int i = 0; i < loader->count; i++) {
+            if (!uploaded[i] && atomic_load(&loader->jobs[i].decoded)) {
+                loader_upload(&loader->jobs[i]);
+                uploaded[i] = true;
+                any         = true;
+                loaded++;
+                if (progress) {
+                    progress(loaded, loader->count, user);
+                }
+            }
+        }
+        if (any) {
+            continue;
+        }
+
+        // a job decoded since the scan is seen by the next one
+        pthread_mutex_lock(&loader->mutex);
+        bool waiting = true;
+        for (int i = 0; i < loader->count; i++) {
+            waiting = waiting && (uploaded[i] || !atomic_load(&loader->jobs[i].decoded));
+        }
+        if (waiting) {
+            pthread_cond_wait(&loader->decoded, &loader->mutex);
+        }
+        pthread_mutex_unlock(&loader->mutex);
+    }
+    free(uploaded);
+
+    for (int i = 0; i < loader->worker_count; i++) {
+        pthread_join(loader->workers[i], NULL);
+    }
+    loader->worker_count = 0;
+}
+
+// the targets stay loaded, only the queue goes
+void loader_free(Loader* loader) {
+    free(loader->jobs);
+    pthread_mutex_destroy(&loader->mutex);
+    pthread_cond_destroy(&loader->decoded);
+    free(loader);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "mesh_cache.h"
+
+#define LOADER_THREADS_MAX 16
+#define LOADER_JOBS_INITIAL_CAPACITY 16
+
+typedef struct LoaderJob LoaderJob;
+typedef struct Loader Loader;
+
+typedef enum {
+    LOADER_IMAGE,  // CPU only, nothing to upload
+    LOADER_TEXTURE,
+    LOADER_MODEL,  // OBJ through the mesh cache
+    LOADER_MESHES, // CPU only, the mesh cache without textures
+    LOADER_FONT,   // through the font cache
+    LOADER_SOUND,
+} LoaderKind;
+
+// loaded and total jobs, called on the main thread after every upload
+typedef void (*LoaderProgress)(int loaded, int total, void* user);
+
+// One file, decoded by a worker into the CPU side fields, then uploaded by
+// the main thread into target: an Image, Texture2D, Model, MeshCacheModel,
+// Font or Sound.
+struct LoaderJob {
+    LoaderKind kind;
+    const char* path;
+    void* target;
+    int font_size;
+    int font_glyphs;
+    int font_type;
+
+    Image image; // image, texture and font atlas
+    MeshCacheModel model;
+    Font font;
+    Wave wave;
+    atomic_bool decoded;
+};
+
+// Files queued with the loader_add functions and loaded at once by
+// loader_run: decoding, rasterizing and parsing on a pool of worker threads,
+// the GPU and audio uploads on the calling thread, in the order they finish.
+struct Loader {
+    LoaderJob* jobs;
+    int count;
+    int capacity;
+    atomic_int next; // first job no worker took yet
+
+    pthread_t workers[LOADER_THREADS_MAX];
+    int worker_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t decoded; // signaled with the mutex held after every job
+};
+
+Loader* loader_new(void);
+void loader_add_image(Loader* loader, Image* image, const char* path);
+void loader_add_texture(Loader* loader, Texture2D* texture, const char* path);
+void loader_add_model(Loader* loader, Model* model, const char* obj_path);
+void loader_add_meshes(Loader* loader, MeshCacheModel* model, const char* obj_path);
+void loader_add_font(Loader* loader, Font* font, const char* path, int size, int glyphs, int type);
+void loader_add_sound(Loader* loader, Sound* sound, const char* path);
+void loader_run(Loader* loader, LoaderProgress progress, void* user);
+void loader_free(Loader* loader);
@@ -0,0 +1,77 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct LruKey LruKey;
+typedef struct Lru Lru;
+
+// First member of every entry of an Lru. The hash only picks the candidates,
+// the same function given to lru_find tells collisions apart.
+struct LruKey {
+    unsigned long long hash;
+    unsigned long last_used;
+};
+
+// Fixed array of entries, owned by the caller, found by hash. It fills up to
+// capacity, then the least recently used entry is replaced.
+struct Lru {
+    void* entries;
+    size_t entry_size;
+    int capacity;
+    int count;
+    unsigned long tick;
+};
+
+typedef bool (*LruSame)(const void* entry, const void* key);
+typedef void (*LruUnload)(void* entry);
+
+static inline LruKey* lru_at(Lru* lru, int index) {
+    return (LruKey*)((char*)lru->entries + index * lru->entry_size);
+}
+
+// The entry with this hash that same accepts for key, marked used. NULL when none.
+static inline void* lru_find(Lru* lru, unsigned long long hash, LruSame same, const void* key) {
+    lru->tick++;
+    for (int i = 0; i < lru->count; i++) {
+        LruKey* entry = lru_at(lru, i);
+        if ((entry->hash == hash) && same(entry, key)) {
+            entry->last_used = lru->tick;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Empties entry, unloading what it held, and keys it with hash.
+static inline void lru_reset(Lru* lru, void* entry, unsigned long long hash, LruUnload unload) {
+    unload(entry);
+    memset(entry, 0, lru->entry_size);
+    *(LruKey*)entry = (LruKey){hash, lru->tick};
+}
+
+// A zeroed entry keyed with hash, after a lru_find that missed. The entry it
+// replaces, if any, is unloaded first.
+static inline void* lru_insert(Lru* lru, unsigned long long hash, LruUnload unload) {
+    if (lru->count < lru->capacity) {
+        LruKey* entry = lru_at(lru, lru->count++);
+        memset(entry, 0, lru->entry_size);
+        *entry = (LruKey){hash, lru->tick};
+        return entry;
+    }
+    LruKey* oldest = lru_at(lru, 0);
+    for (int i = 1; i < lru->count; i++) {
+        if (lru_at(lru, i)->last_used < oldest->last_used) {
+            oldest = lru_at(lru, i);
+        }
+    }
+    lru_reset(lru, oldest, hash, unload);
+    return oldest;
+}
+
+static inline void lru_clear(Lru* lru, LruUnload unload) {
+    for (int i = 0; i < lru->count; i++) {
+        unload(lru_at(lru, i));
+    }
+    lru->count = 0;
+}
@@ -1,29 +1,86 @@
 #include "map.h"
+#include <limits.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "hash.h"
 
-#define BUFFER_SIZE 25
-#define FILE_READ "r"
+#define FILE_READ_BINARY "rb"
 #define SPACE 32
 #define NEW_LINE 10
 
 Grid grid_new(size_t rows, size_t cols) {
-    Cel** c = (Cel**)calloc(rows, sizeof(Cel*));
-    for (int i = 0; i < rows; i++) {
-        c[i] = (Cel*)calloc(cols, sizeof(Cel));
+    Cel* c = (Cel*)calloc(rows * cols, sizeof(Cel));
+    if (!c && (rows * cols > 0)) {
+        printf("[ERROR] Could not allocate grid: %zu %zu\n", rows, cols);
+        exit(EXIT_FAILURE);
     }
-    Grid g = {c, rows, cols};
+    Grid g = {c, rows, cols, NULL, 0, NULL, 0};
     return g;
 }
 
+// Resize keeping every cel that fits in the new size, new cels are zeroed.
+// The potentially visible set does not survive it.
 void grid_update_size(Grid* grid, size_t rows, size_t cols) {
-    return;
+    if ((grid->rows == rows) && (grid->cols == cols)) {
+        return;
+    }
+
+    Grid   resized   = grid_new(rows, cols);
+    size_t keep_rows = grid->rows < rows ? grid->rows : rows;
+    size_t keep_cols = grid->cols < cols ? grid->cols : cols;
+    for (size_t row = 0; row < keep_rows; row++) {
+        memcpy(grid_row(resized, row), grid_row(*grid, row), keep_cols * sizeof(Cel));
+    }
+
+    grid_free(grid);
+    *grid = resized;
+}
+
+void grid_free(Grid* grid) {
+    if (grid->mapping) {
+        munmap(grid->mapping, grid->mapping_size);
+    } else {
+        free(grid->cels);
+        free(grid->pvs);
+    }
+    grid->mapping      = NULL;
+    grid->mapping_size = 0;
+    grid->pvs          = NULL;
+    grid->pvs_stride   = 0;
+    grid->pvs_solid    = 0;
+    grid->cels = NULL;
+    grid->rows = 0;
+    grid->cols = 0;
+}
+
+// Copies a mapped grid into memory it owns, so it can be changed freely.
+void grid_detach(Grid* grid) {
+    if (!grid->mapping) {
+        return;
+    }
+    Grid owned = grid_new(grid->rows, grid->cols);
+    memcpy(owned.cels, grid->cels, grid->rows * grid->cols * sizeof(Cel));
+    if (grid->pvs) {
+        size_t bytes     = grid->rows * grid->cols * grid->pvs_stride;
+        owned.pvs        = (uint8_t*)malloc(bytes);
+        owned.pvs_stride = grid->pvs_stride;
+        owned.pvs_solid  = grid->pvs_solid;
+        memcpy(owned.pvs, grid->pvs, bytes);
+    }
+    grid_free(grid);
+    *grid = owned;
 }
 
 void grid_push(Grid grid, size_t row, size_t col, Cel cel) {
     if (grid_index_valid(grid, row, col)) {
-        grid.cels[row][col] = cel;
+        *grid_at(grid, row, col) = cel;
     } else {
         printf("[ERROR] Grid push invalid: %lo %lo\n", row, col);
         exit(EXIT_FAILURE);
@@ -44,32 +101,321 @@ int grid_area(Grid grid) {
     return grid.cols * grid.rows;
 }
 
-Grid grid_load(char* path) {
-    FILE* f;
-    char* line = {0};
+typedef struct {
+    const char* path;
+    const char* data;
+    size_t      size;
+    size_t      pos;
+    size_t      line;
+    size_t      line_start;
+} MapReader;
+
+static void map_error(MapReader* reader, const char* message) {
+    printf("[ERROR] Invalid map %s:%zu:%zu: %s\n", reader->path, reader->line, reader->pos - reader->line_start + 1,
+           message);
+    exit(EXIT_FAILURE);
+}
+
+static bool is_blank(char c) {
+    return (c == SPACE) || (c == '\t') || (c == '\r');
+}
+
+static bool is_digit(char c) {
+    return (c >= '0') && (c <= '9');
+}
 
-    f = fopen(path, FILE_READ);
+static char* file_read_all(const char* path, size_t* size) {
+    FILE* f = fopen(path, FILE_READ_BINARY);
     if (!f) {
-        printf("[ERROR] Cound not open the file map: %s", path);
-    }
-
-    char   c    = 0;
-    size_t rows = 0, cols = 0;
-    Grid   grid = grid_new(BUFFER_SIZE, BUFFER_SIZE);
-    do {
-        c = (char)fgetc(f);
-        if ((c != SPACE) && (c != NEW_LINE)) {
-            grid_push(grid, rows, cols, (Cel){atoi(&c)});
-            cols++;
-            printf("%c ", c);
+        printf("[ERROR] Cound not open the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char* data = (char*)malloc(length + 1);
+    if (!data || (fread(data, 1, length, f) != (size_t)length)) {
+        printf("[ERROR] Could not read the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    data[length] = '\0';
+    fclose(f);
+
+    *size = length;
+    return data;
+}
+
+// Number of cels in the line starting at pos, used to size the grid before parsing.
+static size_t line_count_cels(MapReader* reader, size_t pos, size_t* line_length) {
+    size_t count   = 0;
+    bool   in_cell = false;
+    size_t i       = pos;
+    for (; (i < reader->size) && (reader->data[i] != NEW_LINE); i++) {
+        bool blank = is_blank(reader->data[i]);
+        count += !blank && !in_cell;
+        in_cell = !blank;
+    }
+    *line_length = i - pos + 1;
+    return count;
+}
+
+static int map_read_int(MapReader* reader) {
+    const char* data     = reader->data;
+    bool        negative = data[reader->pos] == '-';
+    reader->pos += negative;
+    if ((reader->pos >= reader->size) || !is_digit(data[reader->pos])) {
+        map_error(reader, "expected a number");
+    }
+
+    long value = 0;
+    while ((reader->pos < reader->size) && is_digit(data[reader->pos])) {
+        value = value * 10 + (data[reader->pos] - '0');
+        if (value > INT_MAX) {
+            map_error(reader, "number too large");
         }
-        if (c == NEW_LINE) {
-            cols = 0;
+        reader->pos++;
+    }
+    if ((reader->pos < reader->size) && !is_blank(data[reader->pos]) && (data[reader->pos] != NEW_LINE)) {
+        map_error(reader, "unexpected character");
+    }
+    return negative ? (int)-value : (int)value;
+}
+
+// Whitespace separated integers, one row per line. The first non empty line
+// sets the number of cols and every other row must match it.
+static Grid grid_load_text(char* path) {
+    MapReader reader = {0};
+    reader.path      = path;
+    reader.data      = file_read_all(path, &reader.size);
+    reader.line      = 1;
+
+    Grid   grid = {0};
+    size_t rows = 0;
+    while (reader.pos < reader.size) {
+        size_t col = 0;
+        while ((reader.pos < reader.size) && (reader.data[reader.pos] != NEW_LINE)) {
+            char c = reader.data[reader.pos];
+            if (is_blank(c)) {
+                reader.pos++;
+                continue;
+            }
+            if (!is_digit(c) && (c != '-')) {
+                map_error(&reader, "unexpected character");
+            }
+
+            if (grid.cels == NULL) {
+                size_t line_length = 0;
+                size_t cols        = line_count_cels(&reader, reader.line_start, &line_length);
+                grid               = grid_new(reader.size / line_length + 1, cols);
+            }
+            if (col >= grid.cols) {
+                map_error(&reader, "row has more cels than the first one");
+            }
+            if (rows >= grid.rows) {
+                grid_update_size(&grid, grid.rows * 2, grid.cols);
+            }
+            grid_at(grid, rows, col++)->raw_value = map_read_int(&reader);
+        }
+
+        if (col > 0) {
+            if (col != grid.cols) {
+                map_error(&reader, "row has less cels than the first one");
+            }
             rows++;
-            printf("\n");
         }
-    } while (c != EOF);
+        reader.pos++;
+        reader.line++;
+        reader.line_start = reader.pos;
+    }
+
+    free((char*)reader.data);
+    grid_update_size(&grid, rows, grid.cols);
+    return grid;
+}
+
+uint32_t grid_checksum(Grid grid) {
+    return hash32_bytes(HASH32_OFFSET, grid.cels, grid.rows * grid.cols * sizeof(Cel));
+}
+
+#define MAP_HEADER_V1_SIZE offsetof(MapHeader, chunk_size)
+
+size_t map_header_chunk_rows(MapHeader header) {
+    return (header.rows + header.chunk_size - 1) / header.chunk_size;
+}
 
+size_t map_header_chunk_cols(MapHeader header) {
+    return (header.cols + header.chunk_size - 1) / header.chunk_size;
+}
+
+static size_t map_header_cels_size(MapHeader header) {
+    size_t cels = (size_t)header.rows * header.cols;
+    if (header.chunk_size > 0) {
+        cels = map_header_chunk_rows(header) * map_header_chunk_cols(header) * header.chunk_size * header.chunk_size;
+    }
+    return cels * header.layers * header.cel_width;
+}
+
+// Validates a header read from a file of file_size bytes, fields that are not
+// in its version are zeroed.
+void map_header_check(MapHeader* header, size_t file_size, const char* path) {
+    if ((header->version < 1) || (header->version > MAP_BINARY_VERSION)) {
+        printf("[ERROR] Unsupported map version %u, expected up to %u: %s\n", header->version, MAP_BINARY_VERSION,
+               path);
+        exit(EXIT_FAILURE);
+    }
+    if (header->version < 2) {
+        header->chunk_size = 0;
+    }
+    if (header->version < 3) {
+        header->pvs_offset = 0;
+        header->pvs_stride = 0;
+    }
+    if (header->version < 4) {
+        header->pvs_solid = 0;
+    }
+    if ((header->cel_width != sizeof(Cel)) || (header->layers < 1)) {
+        printf("[ERROR] Unsupported map cel width %u with %u layers: %s\n", header->cel_width, header->layers, path);
+        exit(EXIT_FAILURE);
+    }
+    if ((header->cels_offset % sizeof(Cel) != 0) || (header->cels_offset + map_header_cels_size(*header) > file_size)) {
+        printf("[ERROR] Truncated map file: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (header->pvs_offset && (header->pvs_offset + (size_t)header->rows * header->cols * header->pvs_stride > file_size)) {
+        printf("[ERROR] Truncated map visibility: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void grid_save_binary_chunked(Grid grid, const char* path, size_t chunk_size) {
+    MapHeader header = {0};
+    memcpy(header.magic, MAP_BINARY_MAGIC, sizeof(header.magic));
+    header.version     = MAP_BINARY_VERSION;
+    header.rows        = grid.rows;
+    header.cols        = grid.cols;
+    header.cel_width   = sizeof(Cel);
+    header.layers      = 1;
+    header.checksum    = grid_checksum(grid);
+    header.cels_offset = sizeof(MapHeader);
+    header.chunk_size  = chunk_size;
+    header.pvs_stride  = grid.pvs ? grid.pvs_stride : 0;
+    header.pvs_offset  = grid.pvs ? header.cels_offset + map_header_cels_size(header) : 0;
+    header.pvs_solid   = grid.pvs ? grid.pvs_solid : 0;
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        printf("[ERROR] Could not create the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    bool written = fwrite(&header, sizeof(header), 1, f) == 1;
+    if (chunk_size == 0) {
+        size_t cels = grid.rows * grid.cols;
+        written     = written && (fwrite(grid.cels, sizeof(Cel), cels, f) == cels);
+    } else {
+        Grid chunk = grid_new(chunk_size, chunk_size);
+        for (size_t chunk_row = 0; chunk_row < map_header_chunk_rows(header); chunk_row++) {
+            for (size_t chunk_col = 0; chunk_col < map_header_chunk_cols(header); chunk_col++) {
+                for (size_t row = 0; row < chunk_size; row++) {
+                    for (size_t col = 0; col < chunk_size; col++) {
+                        size_t grid_row = chunk_row * chunk_size + row;
+                        size_t grid_col = chunk_col * chunk_size + col;
+                        bool   inside   = (grid_row < grid.rows) && (grid_col < grid.cols);
+                        *grid_at(chunk, row, col) = inside ? *grid_at(grid, grid_row, grid_col) : (Cel){0};
+                    }
+                }
+                size_t cels = chunk_size * chunk_size;
+                written     = written && (fwrite(chunk.cels, sizeof(Cel), cels, f) == cels);
+            }
+        }
+        grid_free(&chunk);
+    }
+    if (grid.pvs) {
+        size_t bytes = grid.rows * grid.cols * grid.pvs_stride;
+        written      = written && (fwrite(grid.pvs, 1, bytes, f) == bytes);
+    }
+    if (!written) {
+        printf("[ERROR] Could not write the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
     fclose(f);
+}
+
+void grid_save_binary(Grid grid, const char* path) {
+    grid_save_binary_chunked(grid, path, 0);
+}
+
+// Chunked maps are meant to be streamed, loading one whole means copying it
+// back to row-major order.
+static Grid grid_from_chunks(MapHeader* header, const Cel* cels) {
+    Grid   grid       = grid_new(header->rows, header->cols);
+    size_t chunk_size = header->chunk_size;
+    size_t chunk_cols = map_header_chunk_cols(*header);
+    for (size_t row = 0; row < grid.rows; row++) {
+        for (size_t col = 0; col < grid.cols; col++) {
+            size_t chunk = (row / chunk_size) * chunk_cols + col / chunk_size;
+            size_t index = chunk * chunk_size * chunk_size + (row % chunk_size) * chunk_size + col % chunk_size;
+            *grid_at(grid, row, col) = cels[index];
+        }
+    }
     return grid;
 }
+
+// The cels are used in place from a private mapping: only the pages that are
+// touched get read and writes never reach the file. The checksum is left to
+// the tools, checking it here would read the whole file.
+static Grid grid_load_binary(char* path, int fd, size_t size) {
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        printf("[ERROR] Could not map the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    MapHeader header = {0};
+    memcpy(&header, mapping, size < sizeof(MapHeader) ? size : sizeof(MapHeader));
+    map_header_check(&header, size, path);
+
+    Cel*     cels = (Cel*)((char*)mapping + header.cels_offset);
+    uint8_t* pvs  = header.pvs_offset ? (uint8_t*)mapping + header.pvs_offset : NULL;
+    if (header.chunk_size > 0) {
+        Grid grid = grid_from_chunks(&header, cels);
+        if (pvs) {
+            size_t bytes    = grid.rows * grid.cols * header.pvs_stride;
+            grid.pvs        = (uint8_t*)malloc(bytes);
+            grid.pvs_stride = header.pvs_stride;
+            grid.pvs_solid  = header.pvs_solid;
+            memcpy(grid.pvs, pvs, bytes);
+        }
+        munmap(mapping, size);
+        return grid;
+    }
+
+    Grid grid         = {0};
+    grid.cels         = cels;
+    grid.rows         = header.rows;
+    grid.cols         = header.cols;
+    grid.mapping      = mapping;
+    grid.mapping_size = size;
+    grid.pvs          = pvs;
+    grid.pvs_stride   = header.pvs_stride;
+    grid.pvs_solid    = header.pvs_solid;
+    return grid;
+}
+
+Grid grid_load(char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("[ERROR] Cound not open the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    char        magic[sizeof(MAP_BINARY_MAGIC) - 1] = {0};
+    if ((fstat(fd, &st) == 0) && ((size_t)st.st_size >= MAP_HEADER_V1_SIZE) &&
+        (read(fd, magic, sizeof(magic)) == sizeof(magic)) && (memcmp(magic, MAP_BINARY_MAGIC, sizeof(magic)) == 0)) {
+        return grid_load_binary(path, fd, st.st_size);
+    }
+    close(fd);
+    return grid_load_text(path);
+}
@@ -1,24 +1,89 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 typedef struct Grid Grid;
 typedef struct Cel Cel;
+typedef struct MapHeader MapHeader;
 
 struct Cel{
     int raw_value;
 };
 
+// Cels live in a single row-major allocation: cel (row, col) is at row * cols + col.
 struct Grid {
-    Cel** cels;
+    Cel* cels;
     size_t rows;
     size_t cols;
+    // set when cels point inside a mapped binary map file
+    void* mapping;
+    size_t mapping_size;
+    // potentially visible set, pvs_stride bytes per cel, see pvs.h
+    uint8_t* pvs;
+    size_t pvs_stride;
+    // solid tiles the pvs was baked with, see TileRenderer
+    uint32_t pvs_solid;
+};
+
+#define MAP_BINARY_MAGIC "RLMP"
+#define MAP_BINARY_VERSION 4
+
+// Binary map file: this header followed, at cels_offset, by layers arrays of
+// rows * cols cels of cel_width bytes, little endian.
+// When chunk_size is 0 the cels are row-major, otherwise they are stored chunk
+// by chunk, in row-major chunk order, each chunk a row-major square of
+// chunk_size * chunk_size cels padded with zeroed cels past the map border.
+// When pvs_offset is not 0 the potentially visible set of every cel follows
+// there, pvs_stride bytes per cel in row-major cel order, computed with the
+// tiles of pvs_solid being solid.
+struct MapHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t cel_width;
+    uint32_t layers;
+    uint32_t checksum; // FNV-1a of every cel, in row-major order
+    uint32_t cels_offset;
+    // version 2
+    uint32_t chunk_size;
+    // version 3
+    uint32_t pvs_offset;
+    uint32_t pvs_stride;
+    // version 4
+    uint32_t pvs_solid;
 };
 
 void grid_update_size(Grid* grid, size_t rows, size_t cols);
 void grid_push(Grid grid, size_t col, size_t row, Cel cel);
 Grid grid_new(size_t rows, size_t cols);
 Grid grid_load(char* path);
+void grid_save_binary(Grid grid, const char* path);
+void grid_save_binary_chunked(Grid grid, const char* path, size_t chunk_size);
+void map_header_check(MapHeader* header, size_t file_size, const char* path);
+size_t map_header_chunk_rows(MapHeader header);
+size_t map_header_chunk_cols(MapHeader header);
+uint32_t grid_checksum(Grid grid);
+void grid_free(Grid* grid);
+void grid_detach(Grid* grid);
 int grid_area(Grid grid);
 bool grid_index_valid(Grid grid, int row, int col);
+
+// distance, in cels, between two consecutive rows and two consecutive cols
+static inline size_t grid_row_stride(Grid grid) {
+    return grid.cols;
+}
+
+static inline size_t grid_col_stride(Grid grid) {
+    return 1;
+}
+
+static inline Cel* grid_row(Grid grid, size_t row) {
+    return grid.cels + row * grid_row_stride(grid);
+}
+
+static inline Cel* grid_at(Grid grid, size_t row, size_t col) {
+    return grid_row(grid, row) + col * grid_col_stride(grid);
+}
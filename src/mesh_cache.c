@@ -0,0 +1,501 @@
+#include "mesh_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash.h"
+#include "raymath.h"
+
+#define MESH_CACHE_MATERIALS_MAX 64
+
+// Whole file, NUL terminated, NULL when it cannot be read
+static char* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = (char*)malloc(length + 1);
+    if ((length < 0) || (fread(data, 1, length, f) != (size_t)length)) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    data[length] = '\0';
+    fclose(f);
+    *size = length;
+    return data;
+}
+
+static uint64_t file_hash(const char* path) {
+    size_t size = 0;
+    char*  data = read_file(path, &size);
+    if (!data) {
+        return 0;
+    }
+    uint64_t hash = hash_bytes(HASH_OFFSET, data, size);
+    free(data);
+    return hash;
+}
+
+static void cache_path(const char* obj_path, char* path, size_t size) {
+    uint64_t key = hash_string(HASH_OFFSET, obj_path);
+    snprintf(path, size, "%s/%016llx.rlms", MESH_CACHE_DIR, (unsigned long long)key);
+}
+
+// A touched but unchanged source keeps its cache
+static bool source_unchanged(const char* path, int64_t mtime, uint64_t size, uint64_t hash) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    if ((mtime == (int64_t)st.st_mtime) && (size == (uint64_t)st.st_size)) {
+        return true;
+    }
+    return (size == (uint64_t)st.st_size) && (hash == file_hash(path));
+}
+
+static void join_path(char* path, const char* dir, const char* name) {
+    snprintf(path, MESH_CACHE_PATH_MAX, "%s%s", dir, name);
+}
+
+// Rest of the line without the surrounding spaces
+static void line_rest(const char* line, char* out, size_t size) {
+    while ((*line == ' ') || (*line == '\t')) {
+        line++;
+    }
+    size_t length = strcspn(line, "\r\n");
+    while ((length > 0) && ((line[length - 1] == ' ') || (line[length - 1] == '\t'))) {
+        length--;
+    }
+    length = length < size - 1 ? length : size - 1;
+    memcpy(out, line, length);
+    out[length] = '\0';
+}
+
+typedef struct {
+    float* data;
+    int count; // floats
+    int capacity;
+} FloatArray;
+
+static void float_push(FloatArray* array, float value) {
+    if (array->count == array->capacity) {
+        array->capacity = array->capacity ? array->capacity * 2 : 256;
+        array->data     = (float*)realloc(array->data, array->capacity * sizeof(float));
+    }
+    array->data[array->count++] = value;
+}
+
+typedef struct {
+    FloatArray vertices;
+    FloatArray texcoords;
+    FloatArray normals;
+} CookMesh;
+
+typedef struct {
+    MeshCacheMaterial materials[MESH_CACHE_MATERIALS_MAX];
+    int count;
+} CookMaterials;
+
+static void parse_mtl(const char* path, const char* dir, CookMaterials* materials) {
+    size_t size = 0;
+    char*  text = read_file(path, &size);
+    if (!text) {
+        printf("[ERROR] Could not read the materials: %s\n", path);
+        return;
+    }
+    MeshCacheMaterial* material = NULL;
+    for (char* line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if ((strncmp(line, "newmtl ", 7) == 0) && (materials->count < MESH_CACHE_MATERIALS_MAX)) {
+            material  = &materials->materials[materials->count++];
+            *material = (MeshCacheMaterial){"", {255, 255, 255, 255}};
+        } else if (material && (strncmp(line, "Kd ", 3) == 0)) {
+            char* end = line + 3;
+            for (int i = 0; i < 3; i++) {
+                material->color[i] = (uint8_t)(Clamp(strtof(end, &end), 0.0f, 1.0f) * 255.0f);
+            }
+        } else if (material && (strncmp(line, "map_Kd ", 7) == 0)) {
+            char name[MESH_CACHE_PATH_MAX];
+            line_rest(line + 7, name, sizeof(name));
+            join_path(material->texture, dir, name);
+        }
+    }
+    free(text);
+}
+
+// 1 based, negative from the end, 0 when missing
+static int obj_index(char** cursor, int count) {
+    if (**cursor == '/') {
+        return 0;
+    }
+    int index = (int)strtol(*cursor, cursor, 10);
+    return index < 0 ? count + index + 1 : index;
+}
+
+static void cook_vertex(CookMesh* mesh, FloatArray* positions, FloatArray* texcoords, FloatArray* normals, int v, int vt,
+                        int vn) {
+    for (int i = 0; i < 3; i++) {
+        float_push(&mesh->vertices, (v > 0) && (v * 3 <= positions->count) ? positions->data[(v - 1) * 3 + i] : 0.0f);
+        float_push(&mesh->normals, (vn > 0) && (vn * 3 <= normals->count) ? normals->data[(vn - 1) * 3 + i] : 0.0f);
+    }
+    bool has_uv = (vt > 0) && (vt * 2 <= texcoords->count);
+    float_push(&mesh->texcoords, has_uv ? texcoords->data[(vt - 1) * 2] : 0.0f);
+    // flipped as LoadOBJ does, textures are loaded top row first
+    float_push(&mesh->texcoords, has_uv ? 1.0f - texcoords->data[(vt - 1) * 2 + 1] : 0.0f);
+}
+
+static void model_from_cook(MeshCacheModel* model, CookMesh* cook, CookMaterials* materials) {
+    model->material_count = materials->count > 0 ? materials->count : 1;
+    model->materials      = (MeshCacheMaterial*)malloc(model->material_count * sizeof(MeshCacheMaterial));
+    model->materials[0]   = (MeshCacheMaterial){"", {255, 255, 255, 255}};
+    memcpy(model->materials, materials->materials, materials->count * sizeof(MeshCacheMaterial));
+    model->meshes         = (Mesh*)calloc(1, sizeof(Mesh));
+    model->mesh_materials = (int*)calloc(1, sizeof(int));
+    model->mesh_count     = 1;
+
+    Mesh* mesh          = &model->meshes[0];
+    mesh->vertexCount   = cook->vertices.count / 3;
+    mesh->triangleCount = mesh->vertexCount / 3;
+    mesh->vertices      = cook->vertices.data;
+    mesh->texcoords     = cook->texcoords.data;
+    mesh->normals       = cook->normals.data;
+    mesh_opt_optimize(mesh, &model->stats);
+}
+
+// OBJ and MTL text into one welded and ordered mesh, false when the OBJ cannot be read. Like
+// LoadOBJ in raylib 5.0 every face is in that mesh, drawn with the first
+// material, the others are kept for reference.
+bool mesh_cache_parse(const char* obj_path, MeshCacheModel* model) {
+    size_t size = 0;
+    char*  text = read_file(obj_path, &size);
+    if (!text) {
+        return false;
+    }
+    *model = (MeshCacheModel){0};
+
+    char        dir[MESH_CACHE_PATH_MAX] = {0};
+    const char* slash                    = strrchr(obj_path, '/');
+    if (slash) {
+        memcpy(dir, obj_path, slash - obj_path + 1 < MESH_CACHE_PATH_MAX ? slash - obj_path + 1 : 0);
+    }
+
+    FloatArray     positions = {0};
+    FloatArray     texcoords = {0};
+    FloatArray     normals   = {0};
+    CookMaterials* materials = (CookMaterials*)calloc(1, sizeof(CookMaterials));
+    CookMesh       mesh      = {0};
+
+    for (char* line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        char* cursor = line + 2;
+        if (strncmp(line, "v ", 2) == 0) {
+            for (int i = 0; i < 3; i++) {
+                float_push(&positions, strtof(cursor, &cursor));
+            }
+        } else if (strncmp(line, "vt ", 3) == 0) {
+            cursor = line + 3;
+            for (int i = 0; i < 2; i++) {
+                float_push(&texcoords, strtof(cursor, &cursor));
+            }
+        } else if (strncmp(line, "vn ", 3) == 0) {
+            cursor = line + 3;
+            for (int i = 0; i < 3; i++) {
+                float_push(&normals, strtof(cursor, &cursor));
+            }
+        } else if (strncmp(line, "f ", 2) == 0) {
+            int face[3][3];
+            int corners = 0;
+            while (true) {
+                while ((*cursor == ' ') || (*cursor == '\t')) {
+                    cursor++;
+                }
+                if ((*cursor == '\0') || (*cursor == '\n') || (*cursor == '\r')) {
+                    break;
+                }
+                int ref[3] = {0};
+                ref[0]     = obj_index(&cursor, positions.count / 3);
+                if (*cursor == '/') {
+                    cursor++;
+                    ref[1] = obj_index(&cursor, texcoords.count / 2);
+                    if (*cursor == '/') {
+                        cursor++;
+                        ref[2] = obj_index(&cursor, normals.count / 3);
+                    }
+                }
+                // polygons as a fan around their first corner
+                if (corners < 3) {
+                    memcpy(face[corners++], ref, sizeof(ref));
+                } else {
+                    memcpy(face[1], face[2], sizeof(ref));
+                    memcpy(face[2], ref, sizeof(ref));
+                }
+                if (corners == 3) {
+                    for (int k = 0; k < 3; k++) {
+                        cook_vertex(&mesh, &positions, &texcoords, &normals, face[k][0], face[k][1], face[k][2]);
+                    }
+                }
+            }
+        } else if ((strncmp(line, "mtllib ", 7) == 0) && (model->mtl_path[0] == '\0')) {
+            char name[MESH_CACHE_PATH_MAX];
+            line_rest(line + 7, name, sizeof(name));
+            join_path(model->mtl_path, dir, name);
+            parse_mtl(model->mtl_path, dir, materials);
+        }
+    }
+
+    model_from_cook(model, &mesh, materials);
+    free(positions.data);
+    free(texcoords.data);
+    free(normals.data);
+    free(materials);
+    free(text);
+    return true;
+}
+
+static uint32_t write_array(FILE* f, uint32_t* offset, const void* data, size_t size) {
+    if (!data) {
+        return 0;
+    }
+    static const char padding[4] = {0};
+    uint32_t          start      = *offset;
+    fwrite(data, 1, size, f);
+    fwrite(padding, 1, (4 - size % 4) % 4, f);
+    *offset += (size + 3) / 4 * 4;
+    return start;
+}
+
+bool mesh_cache_write(const char* obj_path, MeshCacheModel model) {
+    struct stat obj;
+    struct stat mtl = {0};
+    if ((stat(obj_path, &obj) != 0) || (model.mtl_path[0] && (stat(model.mtl_path, &mtl) != 0))) {
+        return false;
+    }
+    if ((mkdir("build", 0755) != 0 && errno != EEXIST) || (mkdir(MESH_CACHE_DIR, 0755) != 0 && errno != EEXIST)) {
+        return false;
+    }
+    char path[256];
+    cache_path(obj_path, path, sizeof(path));
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+
+    MeshCacheHeader header = {0};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version          = MESH_CACHE_VERSION;
+    header.obj_mtime        = obj.st_mtime;
+    header.obj_size         = obj.st_size;
+    header.obj_hash         = file_hash(obj_path);
+    header.mtl_mtime        = mtl.st_mtime;
+    header.mtl_size         = mtl.st_size;
+    header.mtl_hash         = model.mtl_path[0] ? file_hash(model.mtl_path) : 0;
+    header.material_count   = model.material_count;
+    header.mesh_count       = model.mesh_count;
+    header.materials_offset = sizeof(header);
+    header.meshes_offset    = header.materials_offset + model.material_count * sizeof(MeshCacheMaterial);
+    memcpy(header.mtl_path, model.mtl_path, sizeof(header.mtl_path));
+
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(model.materials, sizeof(MeshCacheMaterial), model.material_count, f);
+    long           meshes_start = ftell(f);
+    MeshCacheMesh* entries      = (MeshCacheMesh*)calloc(model.mesh_count, sizeof(MeshCacheMesh));
+    fwrite(entries, sizeof(MeshCacheMesh), model.mesh_count, f);
+
+    uint32_t offset = header.meshes_offset + model.mesh_count * sizeof(MeshCacheMesh);
+    for (int m = 0; m < model.mesh_count; m++) {
+        Mesh mesh                   = model.meshes[m];
+        entries[m].material         = model.mesh_materials[m];
+        entries[m].vertex_count     = mesh.vertexCount;
+        entries[m].triangle_count   = mesh.triangleCount;
+        entries[m].vertices_offset  = write_array(f, &offset, mesh.vertices, mesh.vertexCount * 3 * sizeof(float));
+        entries[m].texcoords_offset = write_array(f, &offset, mesh.texcoords, mesh.vertexCount * 2 * sizeof(float));
+        entries[m].normals_offset   = write_array(f, &offset, mesh.normals, mesh.vertexCount * 3 * sizeof(float));
+        entries[m].indices_offset =
+            write_array(f, &offset, mesh.indices, mesh.triangleCount * 3 * sizeof(unsigned short));
+    }
+    fseek(f, meshes_start, SEEK_SET);
+    bool written = fwrite(entries, sizeof(MeshCacheMesh), model.mesh_count, f) == (size_t)model.mesh_count;
+    written      = (fclose(f) == 0) && written;
+    free(entries);
+    return written;
+}
+
+// Copy of an array of the mapping, NULL when missing or past its end
+static void* copy_array(const char* mapping, size_t size, uint32_t offset, size_t bytes, bool* valid) {
+    if (offset == 0) {
+        return NULL;
+    }
+    if (offset + bytes > size) {
+        *valid = false;
+        return NULL;
+    }
+    void* copy = malloc(bytes);
+    memcpy(copy, mapping + offset, bytes);
+    return copy;
+}
+
+// The cooked arrays are copied out of the mapping into buffers UnloadModel
+// can free, false when there is no valid cache for the OBJ
+bool mesh_cache_read(const char* obj_path, MeshCacheModel* model) {
+    char path[256];
+    cache_path(obj_path, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(MeshCacheHeader))) {
+        close(fd);
+        return false;
+    }
+    size_t size    = st.st_size;
+    char*  mapping = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    bool valid = (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0) &&
+                 (header.version == MESH_CACHE_VERSION) &&
+                 (header.materials_offset + (size_t)header.material_count * sizeof(MeshCacheMaterial) <= size) &&
+                 (header.meshes_offset + (size_t)header.mesh_count * sizeof(MeshCacheMesh) <= size);
+    header.mtl_path[MESH_CACHE_PATH_MAX - 1] = '\0';
+    valid = valid && source_unchanged(obj_path, header.obj_mtime, header.obj_size, header.obj_hash);
+    valid = valid && (!header.mtl_path[0] ||
+                      source_unchanged(header.mtl_path, header.mtl_mtime, header.mtl_size, header.mtl_hash));
+    if (!valid) {
+        munmap(mapping, size);
+        return false;
+    }
+
+    *model                = (MeshCacheModel){0};
+    model->mesh_count     = header.mesh_count;
+    model->material_count = header.material_count;
+    model->meshes         = (Mesh*)calloc(header.mesh_count, sizeof(Mesh));
+    model->mesh_materials = (int*)calloc(header.mesh_count, sizeof(int));
+    model->materials      = (MeshCacheMaterial*)malloc(header.material_count * sizeof(MeshCacheMaterial));
+    memcpy(model->materials, mapping + header.materials_offset, header.material_count * sizeof(MeshCacheMaterial));
+    memcpy(model->mtl_path, header.mtl_path, sizeof(model->mtl_path));
+
+    const MeshCacheMesh* entries = (const MeshCacheMesh*)(mapping + header.meshes_offset);
+    for (uint32_t m = 0; m < header.mesh_count; m++) {
+        MeshCacheMesh entry = entries[m];
+        Mesh*         mesh  = &model->meshes[m];
+        mesh->vertexCount   = entry.vertex_count;
+        mesh->triangleCount = entry.triangle_count;
+        mesh->vertices  = (float*)copy_array(mapping, size, entry.vertices_offset, entry.vertex_count * 3 * sizeof(float), &valid);
+        mesh->texcoords = (float*)copy_array(mapping, size, entry.texcoords_offset, entry.vertex_count * 2 * sizeof(float), &valid);
+        mesh->normals   = (float*)copy_array(mapping, size, entry.normals_offset, entry.vertex_count * 3 * sizeof(float), &valid);
+        mesh->indices   = (unsigned short*)copy_array(mapping, size, entry.indices_offset,
+                                                      entry.triangle_count * 3 * sizeof(unsigned short), &valid);
+        model->mesh_materials[m] = entry.material < header.material_count ? entry.material : 0;
+        valid                    = valid && (mesh->vertices != NULL);
+    }
+    munmap(mapping, size);
+    if (!valid) {
+        mesh_cache_model_free(model);
+    }
+    return valid;
+}
+
+// Parses the OBJ and saves it for the next loads, false when the OBJ cannot be read
+bool mesh_cache_cook(const char* obj_path, MeshCacheModel* model) {
+    if (!mesh_cache_parse(obj_path, model)) {
+        return false;
+    }
+    if (!mesh_cache_write(obj_path, *model)) {
+        char path[256];
+        cache_path(obj_path, path, sizeof(path));
+        printf("[ERROR] Could not write the mesh cache: %s\n", path);
+    }
+    return true;
+}
+
+// Meshes to the GPU and material textures loaded, the model takes the arrays
+Model mesh_cache_upload(MeshCacheModel* cpu) {
+    Model model         = {0};
+    model.transform     = MatrixIdentity();
+    model.meshCount     = cpu->mesh_count;
+    model.meshes        = cpu->meshes;
+    model.materialCount = cpu->material_count > 0 ? cpu->material_count : 1;
+    model.materials     = (Material*)calloc(model.materialCount, sizeof(Material));
+    model.meshMaterial  = cpu->mesh_materials;
+
+    for (int i = 0; i < model.materialCount; i++) {
+        model.materials[i] = LoadMaterialDefault();
+        if (i >= cpu->material_count) {
+            continue;
+        }
+        MeshCacheMaterial material = cpu->materials[i];
+        model.materials[i].maps[MATERIAL_MAP_DIFFUSE].color =
+            (Color){material.color[0], material.color[1], material.color[2], material.color[3]};
+        if (cpu->images && material.texture[0]) {
+            model.materials[i].maps[MATERIAL_MAP_DIFFUSE].texture = LoadTextureFromImage(cpu->images[i]);
+            UnloadImage(cpu->images[i]);
+        } else if (material.texture[0]) {
+            model.materials[i].maps[MATERIAL_MAP_DIFFUSE].texture = LoadTexture(material.texture);
+        }
+    }
+    for (int m = 0; m < model.meshCount; m++) {
+        UploadMesh(&model.meshes[m], false);
+    }
+
+    free(cpu->materials);
+    free(cpu->images);
+    *cpu = (MeshCacheModel){0};
+    return model;
+}
+
+void mesh_cache_model_free(MeshCacheModel* model) {
+    for (int m = 0; m < model->mesh_count; m++) {
+        free(model->meshes[m].vertices);
+        free(model->meshes[m].texcoords);
+        free(model->meshes[m].normals);
+        free(model->meshes[m].indices);
+    }
+    free(model->meshes);
+    free(model->mesh_materials);
+    for (int i = 0; model->images && (i < model->material_count); i++) {
+        UnloadImage(model->images[i]);
+    }
+    free(model->images);
+    free(model->materials);
+    *model = (MeshCacheModel){0};
+}
+
+// The model from the cache, cooked again when stale
+void mesh_cache_get(const char* obj_path, MeshCacheModel* model) {
+    if (!mesh_cache_read(obj_path, model)) {
+        if (!mesh_cache_cook(obj_path, model)) {
+            printf("[ERROR] Could not load the model: %s\n", obj_path);
+            exit(EXIT_FAILURE);
+        }
+        printf("[INFO] Mesh cache cooked: %s\n", obj_path);
+    }
+}
+
+// mesh_cache_get with the material textures decoded. No GPU work,
+// mesh_cache_upload finishes it.
+void mesh_cache_decode(const char* obj_path, MeshCacheModel* model) {
+    mesh_cache_get(obj_path, model);
+    model->images = (Image*)calloc(model->material_count, sizeof(Image));
+    for (int i = 0; i < model->material_count; i++) {
+        if (model->materials[i].texture[0]) {
+            model->images[i] = LoadImage(model->materials[i].texture);
+        }
+    }
+}
+
+// LoadModel for OBJ files through the cache
+Model mesh_cache_load(const char* obj_path) {
+    MeshCacheModel cpu = {0};
+    mesh_cache_decode(obj_path, &cpu);
+    return mesh_cache_upload(&cpu);
+}
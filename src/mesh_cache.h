@@ -0,0 +1,77 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "mesh_opt.h"
+
+typedef struct MeshCacheHeader MeshCacheHeader;
+typedef struct MeshCacheMaterial MeshCacheMaterial;
+typedef struct MeshCacheMesh MeshCacheMesh;
+typedef struct MeshCacheModel MeshCacheModel;
+
+#define MESH_CACHE_MAGIC "RLMS"
+#define MESH_CACHE_VERSION 2
+#define MESH_CACHE_DIR "build/models"
+#define MESH_CACHE_PATH_MAX 128
+
+// Cooked model file: this header, material_count materials at
+// materials_offset, mesh_count meshes at meshes_offset, then the arrays of
+// every mesh at their offsets, 4 bytes aligned. One file per OBJ path, stale
+// when the OBJ or its MTL changed size and mtime and their contents hash too.
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    int64_t obj_mtime;
+    uint64_t obj_size;
+    uint64_t obj_hash;
+    int64_t mtl_mtime;
+    uint64_t mtl_size;
+    uint64_t mtl_hash;
+    char mtl_path[MESH_CACHE_PATH_MAX]; // empty without mtllib
+    uint32_t material_count;
+    uint32_t mesh_count;
+    uint32_t materials_offset;
+    uint32_t meshes_offset;
+};
+
+// Diffuse color and texture, the texture path from the working directory
+struct MeshCacheMaterial {
+    char texture[MESH_CACHE_PATH_MAX]; // empty without map_Kd
+    uint8_t color[4];
+};
+
+// Offsets from the file start, 0 when the array is missing. Indices are
+// 16 bits like Mesh.indices, meshes too large for them are not indexed.
+// Triangles and vertices are stored in the order mesh_opt_optimize chose.
+struct MeshCacheMesh {
+    uint32_t material;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    uint32_t vertices_offset;
+    uint32_t texcoords_offset;
+    uint32_t normals_offset;
+    uint32_t indices_offset;
+};
+
+// A model on the CPU, meshes with their arrays and materials not loaded yet
+struct MeshCacheModel {
+    Mesh* meshes;
+    int* mesh_materials;
+    int mesh_count;
+    MeshCacheMaterial* materials;
+    int material_count;
+    char mtl_path[MESH_CACHE_PATH_MAX];
+    MeshOptStats stats; // of mesh_cache_parse, zero when read from the cache
+    Image* images;      // diffuse textures by material, NULL until decoded
+};
+
+bool mesh_cache_read(const char* obj_path, MeshCacheModel* model);
+bool mesh_cache_parse(const char* obj_path, MeshCacheModel* model);
+bool mesh_cache_write(const char* obj_path, MeshCacheModel model);
+bool mesh_cache_cook(const char* obj_path, MeshCacheModel* model);
+void mesh_cache_get(const char* obj_path, MeshCacheModel* model);
+void mesh_cache_decode(const char* obj_path, MeshCacheModel* model);
+Model mesh_cache_upload(MeshCacheModel* model);
+void mesh_cache_model_free(MeshCacheModel* model);
+Model mesh_cache_load(const char* obj_path);
@@ -0,0 +1,325 @@
+#include "mesh_opt.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "hash.h"
+
+#define VALENCE_SCORES_MAX 32
+
+// missing arrays weld as zeros
+static void vertex_key(const Mesh* mesh, int i, float key[8]) {
+    memset(key, 0, 8 * sizeof(float));
+    memcpy(key, &mesh->vertices[i * 3], 3 * sizeof(float));
+    if (mesh->normals) {
+        memcpy(key + 3, &mesh->normals[i * 3], 3 * sizeof(float));
+    }
+    if (mesh->texcoords) {
+        memcpy(key + 6, &mesh->texcoords[i * 2], 2 * sizeof(float));
+    }
+}
+
+static void vertex_copy(Mesh* to, int i, const Mesh* from, int j) {
+    memcpy(&to->vertices[i * 3], &from->vertices[j * 3], 3 * sizeof(float));
+    if (from->normals) {
+        memcpy(&to->normals[i * 3], &from->normals[j * 3], 3 * sizeof(float));
+    }
+    if (from->texcoords) {
+        memcpy(&to->texcoords[i * 2], &from->texcoords[j * 2], 2 * sizeof(float));
+    }
+}
+
+// same arrays as mesh, count vertices long
+static Mesh vertices_alloc(const Mesh* mesh, int count) {
+    Mesh arrays      = {0};
+    arrays.vertices  = (float*)malloc(count * 3 * sizeof(float));
+    arrays.normals   = mesh->normals ? (float*)malloc(count * 3 * sizeof(float)) : NULL;
+    arrays.texcoords = mesh->texcoords ? (float*)malloc(count * 2 * sizeof(float)) : NULL;
+    return arrays;
+}
+
+// the other arrays are not carried over and would no longer match
+static void vertices_free(Mesh* mesh) {
+    free(mesh->vertices);
+    free(mesh->normals);
+    free(mesh->texcoords);
+    free(mesh->texcoords2);
+    free(mesh->colors);
+    free(mesh->tangents);
+    mesh->texcoords2 = NULL;
+    mesh->colors     = NULL;
+    mesh->tangents   = NULL;
+}
+
+// Triangle soup into unique vertices, indices points each corner to its
+// vertex. Returns the welded vertices, in order of first use.
+static Mesh weld(const Mesh* mesh, unsigned int* indices) {
+    int count    = mesh->vertexCount;
+    int capacity = 16;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    int* table = (int*)malloc(capacity * sizeof(int));
+    Mesh welded = vertices_alloc(mesh, count);
+    memset(table, -1, capacity * sizeof(int));
+
+    for (int i = 0; i < count; i++) {
+        float key[8];
+        float other[8];
+        vertex_key(mesh, i, key);
+        uint64_t slot = hash_bytes(HASH_OFFSET, key, sizeof(key)) & (capacity - 1);
+        while (table[slot] != -1) {
+            vertex_key(&welded, table[slot], other);
+            if (memcmp(key, other, sizeof(key)) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == -1) {
+            table[slot] = welded.vertexCount;
+            vertex_copy(&welded, welded.vertexCount++, mesh, i);
+        }
+        indices[i] = table[slot];
+    }
+    free(table);
+    return welded;
+}
+
+// Vertex misses of a FIFO cache like the post-transform cache of GPUs
+long mesh_opt_misses(const unsigned int* indices, int index_count, int vertex_count) {
+    int* stamps = (int*)malloc(vertex_count * sizeof(int));
+    long misses = 0;
+    memset(stamps, -1, vertex_count * sizeof(int));
+    for (int i = 0; i < index_count; i++) {
+        unsigned int v = indices[i];
+        if ((stamps[v] == -1) || (misses - stamps[v] >= MESH_OPT_FIFO_SIZE)) {
+            stamps[v] = misses++;
+        }
+    }
+    free(stamps);
+    return misses;
+}
+
+// Scores from Forsyth, "Linear-Speed Vertex Cache Optimisation": the three
+// vertices of the last triangle, then decaying with the LRU position, plus
+// a bonus for vertices with few triangles left so they are not stranded.
+static float cache_scores[MESH_OPT_CACHE_SIZE];
+static float valence_scores[VALENCE_SCORES_MAX];
+static pthread_once_t scores_once = PTHREAD_ONCE_INIT;
+
+static void scores_init(void) {
+    for (int i = 0; i < MESH_OPT_CACHE_SIZE; i++) {
+        cache_scores[i] = i < 3 ? 0.75f : powf(1.0f - (float)(i - 3) / (MESH_OPT_CACHE_SIZE - 3), 1.5f);
+    }
+    for (int i = 1; i < VALENCE_SCORES_MAX; i++) {
+        valence_scores[i] = 2.0f / sqrtf((float)i);
+    }
+}
+
+static float vertex_score(int position, int remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    float score = position >= 0 ? cache_scores[position] : 0.0f;
+    return score + (remaining < VALENCE_SCORES_MAX ? valence_scores[remaining] : 2.0f / sqrtf((float)remaining));
+}
+
+static bool cache_has(const int* cache, int count, int v) {
+    for (int i = 0; i < count; i++) {
+        if (cache[i] == v) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Greedy triangle order for the post-transform cache, each step emits the
+// best triangle using a cached vertex, else the next one left in the input.
+static void order_triangles(unsigned int* indices, int triangle_count, int vertex_count) {
+    pthread_once(&scores_once, scores_init);
+    int*   remaining  = (int*)calloc(vertex_count, sizeof(int));
+    int*   offsets    = (int*)malloc((vertex_count + 1) * sizeof(int));
+    int*   triangles  = (int*)malloc(triangle_count * 3 * sizeof(int));
+    int*   position   = (int*)malloc(vertex_count * sizeof(int));
+    float* scores     = (float*)malloc(vertex_count * sizeof(float));
+    float* tri_scores = (float*)malloc(triangle_count * sizeof(float));
+    bool*  emitted    = (bool*)calloc(triangle_count, sizeof(bool));
+    unsigned int* out = (unsigned int*)malloc(triangle_count * 3 * sizeof(unsigned int));
+
+    // triangles of each vertex, the ones still to emit first
+    for (int i = 0; i < triangle_count * 3; i++) {
+        remaining[indices[i]]++;
+    }
+    offsets[0] = 0;
+    for (int v = 0; v < vertex_count; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+        remaining[v]   = 0;
+    }
+    for (int i = 0; i < triangle_count * 3; i++) {
+        unsigned int v                        = indices[i];
+        triangles[offsets[v] + remaining[v]++] = i / 3;
+    }
+    for (int v = 0; v < vertex_count; v++) {
+        position[v] = -1;
+        scores[v]   = vertex_score(-1, remaining[v]);
+    }
+    for (int t = 0; t < triangle_count; t++) {
+        tri_scores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    }
+
+    int cache[MESH_OPT_CACHE_SIZE + 3];
+    int cache_count = 0;
+    int next        = 0;
+    int best        = 0;
+    for (int t = 1; t < triangle_count; t++) {
+        best = tri_scores[t] > tri_scores[best] ? t : best;
+    }
+
+    for (int emit = 0; emit < triangle_count; emit++) {
+        if (best < 0) {
+            while (emitted[next]) {
+                next++;
+            }
+            best = next;
+        }
+        emitted[best] = true;
+        memcpy(&out[emit * 3], &indices[best * 3], 3 * sizeof(unsigned int));
+
+        // the new triangle goes in front, the cache entries it pushed out are scored too
+        int fresh[MESH_OPT_CACHE_SIZE + 3];
+        int fresh_count = 0;
+        for (int k = 0; k < 3; k++) {
+            int  v     = indices[best * 3 + k];
+            int* first = &triangles[offsets[v]];
+            for (int i = 0; i < remaining[v]; i++) {
+                if (first[i] == best) {
+                    first[i]                = first[remaining[v] - 1];
+                    first[remaining[v] - 1] = best;
+                    remaining[v]--;
+                    break;
+                }
+            }
+            if (!cache_has(fresh, fresh_count, v)) {
+                fresh[fresh_count++] = v;
+            }
+        }
+        int corners = fresh_count;
+        for (int i = 0; i < cache_count; i++) {
+            if (!cache_has(fresh, corners, cache[i])) {
+                fresh[fresh_count++] = cache[i];
+            }
+        }
+
+        best             = -1;
+        float best_score = -1.0f;
+        for (int i = 0; i < fresh_count; i++) {
+            int v       = fresh[i];
+            position[v] = i < MESH_OPT_CACHE_SIZE ? i : -1;
+            scores[v]   = vertex_score(position[v], remaining[v]);
+        }
+        for (int i = 0; i < fresh_count; i++) {
+            int* first = &triangles[offsets[fresh[i]]];
+            for (int j = 0; j < remaining[fresh[i]]; j++) {
+                int t         = first[j];
+                tri_scores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                if (tri_scores[t] > best_score) {
+                    best       = t;
+                    best_score = tri_scores[t];
+                }
+            }
+        }
+        cache_count = fresh_count < MESH_OPT_CACHE_SIZE ? fresh_count : MESH_OPT_CACHE_SIZE;
+        memcpy(cache, fresh, cache_count * sizeof(int));
+    }
+    memcpy(indices, out, triangle_count * 3 * sizeof(unsigned int));
+
+    free(out);
+    free(emitted);
+    free(tri_scores);
+    free(scores);
+    free(position);
+    free(triangles);
+    free(offsets);
+    free(remaining);
+}
+
+// Vertices renumbered in order of first use, so drawing reads them forward
+static Mesh order_vertices(const Mesh* mesh, unsigned int* indices, int index_count) {
+    int* remap  = (int*)malloc(mesh->vertexCount * sizeof(int));
+    Mesh sorted = vertices_alloc(mesh, mesh->vertexCount);
+    memset(remap, -1, mesh->vertexCount * sizeof(int));
+    for (int i = 0; i < index_count; i++) {
+        unsigned int v = indices[i];
+        if (remap[v] == -1) {
+            remap[v] = sorted.vertexCount;
+            vertex_copy(&sorted, sorted.vertexCount++, mesh, v);
+        }
+        indices[i] = remap[v];
+    }
+    free(remap);
+    return sorted;
+}
+
+// Welds a triangle soup mesh, orders its triangles for the vertex cache and
+// its vertices for fetching, in place on the CPU arrays. Only vertices,
+// normals and texcoords are kept. Meshes already indexed are only ordered.
+// False and untouched when the welded vertices overflow the 16 bit indices
+// of raylib meshes, stats are filled either way.
+bool mesh_opt_optimize(Mesh* mesh, MeshOptStats* stats) {
+    int           index_count = mesh->triangleCount * 3;
+    unsigned int* indices     = (unsigned int*)malloc(index_count * sizeof(unsigned int));
+    Mesh          welded      = {0};
+    *stats                    = (MeshOptStats){0};
+    stats->vertices_before    = mesh->vertexCount;
+    stats->triangles          = mesh->triangleCount;
+    if (mesh->indices) {
+        for (int i = 0; i < index_count; i++) {
+            indices[i] = mesh->indices[i];
+        }
+        stats->misses_before = mesh_opt_misses(indices, index_count, mesh->vertexCount);
+        welded               = *mesh;
+    } else {
+        stats->misses_before = index_count;
+        welded               = weld(mesh, indices);
+    }
+    stats->misses_welded = mesh_opt_misses(indices, index_count, welded.vertexCount);
+
+    if ((index_count == 0) || (welded.vertexCount > MESH_OPT_INDEX_MAX)) {
+        if (!mesh->indices) {
+            vertices_free(&welded);
+        }
+        free(indices);
+        stats->vertices_after = stats->vertices_before;
+        stats->misses_after   = stats->misses_before;
+        return false;
+    }
+
+    order_triangles(indices, mesh->triangleCount, welded.vertexCount);
+    stats->misses_after = mesh_opt_misses(indices, index_count, welded.vertexCount);
+    Mesh sorted         = order_vertices(&welded, indices, index_count);
+    if (!mesh->indices) {
+        vertices_free(&welded);
+        mesh->indices = (unsigned short*)malloc(index_count * sizeof(unsigned short));
+    }
+    for (int i = 0; i < index_count; i++) {
+        mesh->indices[i] = (unsigned short)indices[i];
+    }
+    free(indices);
+
+    vertices_free(mesh);
+    mesh->vertexCount     = sorted.vertexCount;
+    mesh->vertices        = sorted.vertices;
+    mesh->normals         = sorted.normals;
+    mesh->texcoords       = sorted.texcoords;
+    stats->vertices_after = sorted.vertexCount;
+    return true;
+}
+
+void mesh_opt_stats_add(MeshOptStats* total, MeshOptStats stats) {
+    total->vertices_before += stats.vertices_before;
+    total->vertices_after += stats.vertices_after;
+    total->triangles += stats.triangles;
+    total->misses_before += stats.misses_before;
+    total->misses_welded += stats.misses_welded;
+    total->misses_after += stats.misses_after;
+}
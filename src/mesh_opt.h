@@ -0,0 +1,25 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "raylib.h"
+
+typedef struct MeshOptStats MeshOptStats;
+
+#define MESH_OPT_CACHE_SIZE 32 // LRU the triangle order is scored against
+#define MESH_OPT_FIFO_SIZE 16  // FIFO the cache misses are counted with
+#define MESH_OPT_INDEX_MAX 65535
+
+// Cache misses per triangle give the ACMR: 3 for triangle soup, about 0.5 at
+// best on regular grids. welded is the welded mesh in its original order.
+struct MeshOptStats {
+    long vertices_before;
+    long vertices_after;
+    long triangles;
+    long misses_before;
+    long misses_welded;
+    long misses_after;
+};
+
+long mesh_opt_misses(const unsigned int* indices, int index_count, int vertex_count);
+bool mesh_opt_optimize(Mesh* mesh, MeshOptStats* stats);
+void mesh_opt_stats_add(MeshOptStats* total, MeshOptStats stats);
@@ -0,0 +1,155 @@
+#include "mesh_quant.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include "raymath.h"
+#include "rlgl.h"
+
+#define GL_SHORT 0x1402
+#define GL_UNSIGNED_SHORT 0x1403
+#define GL_HALF_FLOAT 0x140B
+
+// shader locations and buffers of UploadMesh in raylib 5.0, indices last
+#define LOCATION_POSITION 0
+#define LOCATION_TEXCOORD 1
+#define LOCATION_NORMAL 2
+#define LOCATION_COLOR 3
+#define MESH_VERTEX_BUFFERS 7
+#define BUFFER_INDICES 6
+
+#define POSITION_MAX 65535.0f
+#define NORMAL_MAX 32767.0f
+
+// round to nearest even, too large to infinity, too small to zero
+static uint16_t half_from_float(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    int      exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+    int shift = 13;
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        shift    = 14 - exponent;
+        exponent = 0;
+    }
+    uint32_t half    = ((uint32_t)exponent << 10) | (mantissa >> shift);
+    uint32_t rest    = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    // a carry out of the mantissa rounds up into the exponent
+    if ((rest > halfway) || ((rest == halfway) && (half & 1))) {
+        half++;
+    }
+    return sign | half;
+}
+
+// Normal on the octahedron |x|+|y|+|z| = 1, the lower half folded over the
+// upper one so that it unfolds to the xy square. Axis normals are exact.
+static void octahedral_from_normal(Vector3 n, int16_t out[2]) {
+    float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (sum == 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float x = n.x / sum;
+    float y = n.y / sum;
+    if (n.z < 0.0f) {
+        float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float folded_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x              = folded_x;
+        y              = folded_y;
+    }
+    out[0] = (int16_t)roundf(Clamp(x, -1.0f, 1.0f) * NORMAL_MAX);
+    out[1] = (int16_t)roundf(Clamp(y, -1.0f, 1.0f) * NORMAL_MAX);
+}
+
+// Smallest power of two step that spans the mesh from an offset on a
+// multiple of it, so the rounding of a position only depends on the step.
+static float position_scale(Vector3 min, Vector3 max, Vector3* offset) {
+    float scale = ldexpf(1.0f, -16);
+    for (;;) {
+        *offset = (Vector3){floorf(min.x / scale) * scale, floorf(min.y / scale) * scale, floorf(min.z / scale) * scale};
+        if (((max.x - offset->x) / scale <= POSITION_MAX) && ((max.y - offset->y) / scale <= POSITION_MAX) &&
+            ((max.z - offset->z) / scale <= POSITION_MAX)) {
+            return scale;
+        }
+        scale *= 2.0f;
+    }
+}
+
+MeshQuant mesh_quant_encode(const Mesh* mesh) {
+    MeshQuant quant    = {0};
+    quant.vertex_count = mesh->vertexCount;
+    quant.vertices     = (MeshQuantVertex*)calloc(mesh->vertexCount > 0 ? mesh->vertexCount : 1, sizeof(MeshQuantVertex));
+    quant.scale        = 1.0f;
+    if (mesh->vertexCount == 0) {
+        return quant;
+    }
+
+    BoundingBox bounds = GetMeshBoundingBox(*mesh);
+    quant.scale        = position_scale(bounds.min, bounds.max, &quant.offset);
+    for (int i = 0; i < mesh->vertexCount; i++) {
+        MeshQuantVertex* vertex = &quant.vertices[i];
+        const float*     p      = &mesh->vertices[i * 3];
+        vertex->position[0]     = (uint16_t)roundf((p[0] - quant.offset.x) / quant.scale);
+        vertex->position[1]     = (uint16_t)roundf((p[1] - quant.offset.y) / quant.scale);
+        vertex->position[2]     = (uint16_t)roundf((p[2] - quant.offset.z) / quant.scale);
+        if (mesh->normals) {
+            const float* n = &mesh->normals[i * 3];
+            octahedral_from_normal((Vector3){n[0], n[1], n[2]}, vertex->normal);
+        }
+        if (mesh->texcoords) {
+            vertex->texcoord[0] = half_from_float(mesh->texcoords[i * 2]);
+            vertex->texcoord[1] = half_from_float(mesh->texcoords[i * 2 + 1]);
+        }
+    }
+    return quant;
+}
+
+// Uploads the mesh in the MeshQuantVertex layout instead of UploadMesh, the
+// CPU arrays are kept. Draw it with the returned transform in front of the
+// model one: it scales the fixed point positions back. The normals stay packed,
+// shader/lighting_quantized.vs unpacks them, see bake_set_shader.
+// Without vertex arrays DrawMesh would bind floats, it falls back to them.
+Matrix mesh_quant_upload(Mesh* mesh) {
+    mesh->vaoId = rlLoadVertexArray();
+    if (mesh->vaoId == 0) {
+        UploadMesh(mesh, false);
+        return MatrixIdentity();
+    }
+    MeshQuant quant = mesh_quant_encode(mesh);
+    mesh->vboId     = (unsigned int*)calloc(MESH_VERTEX_BUFFERS, sizeof(unsigned int));
+    rlEnableVertexArray(mesh->vaoId);
+
+    int stride     = sizeof(MeshQuantVertex);
+    mesh->vboId[0] = rlLoadVertexBuffer(quant.vertices, quant.vertex_count * stride, false);
+    rlSetVertexAttribute(LOCATION_POSITION, 3, GL_UNSIGNED_SHORT, false, stride,
+                         (void*)offsetof(MeshQuantVertex, position));
+    rlEnableVertexAttribute(LOCATION_POSITION);
+    rlSetVertexAttribute(LOCATION_NORMAL, 2, GL_SHORT, true, stride, (void*)offsetof(MeshQuantVertex, normal));
+    rlEnableVertexAttribute(LOCATION_NORMAL);
+    rlSetVertexAttribute(LOCATION_TEXCOORD, 2, GL_HALF_FLOAT, false, stride, (void*)offsetof(MeshQuantVertex, texcoord));
+    rlEnableVertexAttribute(LOCATION_TEXCOORD);
+
+    // like UploadMesh, shaders reading colors get white
+    float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    rlSetVertexAttributeDefault(LOCATION_COLOR, white, RL_SHADER_ATTRIB_VEC4, 4);
+    rlDisableVertexAttribute(LOCATION_COLOR);
+
+    if (mesh->indices) {
+        mesh->vboId[BUFFER_INDICES] =
+            rlLoadVertexBufferElement(mesh->indices, mesh->triangleCount * 3 * sizeof(unsigned short), false);
+    }
+    rlDisableVertexArray();
+    free(quant.vertices);
+
+    // MatrixMultiply applies its left matrix first
+    return MatrixMultiply(MatrixScale(quant.scale, quant.scale, quant.scale),
+                          MatrixTranslate(quant.offset.x, quant.offset.y, quant.offset.z));
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include "raylib.h"
+
+typedef struct MeshQuantVertex MeshQuantVertex;
+typedef struct MeshQuant MeshQuant;
+
+// 16 bytes against the 32 of the float position, normal and texcoord
+// arrays. Positions are 16 bit fixed point from the mesh offset in steps of
+// the mesh scale, a power of two so equal positions in meshes of the same
+// scale stay equal, chunks of the same size do not crack apart. Normals are
+// octahedral snorm, texcoords half floats: 1/256 off at worst for the 9
+// repeats of the tower.
+struct MeshQuantVertex {
+    uint16_t position[4]; // w unused, keeps the normal 4 bytes aligned
+    int16_t normal[2];
+    uint16_t texcoord[2];
+};
+
+struct MeshQuant {
+    MeshQuantVertex* vertices;
+    int vertex_count;
+    Vector3 offset;
+    float scale;
+};
+
+MeshQuant mesh_quant_encode(const Mesh* mesh);
+Matrix mesh_quant_upload(Mesh* mesh);
@@ -0,0 +1,82 @@
+#include "pvs.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "visibility.h"
+
+#define PVS_THREADS_MAX 64
+
+typedef struct {
+    Grid grid;
+    TileRenderer* tiles;
+    atomic_size_t next;
+} PvsJob;
+
+// Cels are handed out one at a time, each worker writes only the sets of the
+// cels it took.
+static void* pvs_worker(void* arg) {
+    PvsJob*    job        = (PvsJob*)arg;
+    Grid       grid       = job->grid;
+    size_t     cels       = grid.rows * grid.cols;
+    Visibility visibility = visibility_new(grid);
+
+    for (size_t index = atomic_fetch_add(&job->next, 1); index < cels; index = atomic_fetch_add(&job->next, 1)) {
+        size_t row = index / grid.cols;
+        size_t col = index % grid.cols;
+        if (tiles_is_solid(job->tiles, grid_at(grid, row, col)->raw_value)) {
+            continue;
+        }
+
+        // rays from a few points spread over the cel, any of them may be the eye
+        visibility_begin(&visibility);
+        for (int x = 0; x < PVS_SAMPLES; x++) {
+            for (int z = 0; z < PVS_SAMPLES; z++) {
+                visibility_cast_around(&visibility, grid, job->tiles, row + (x + 0.5f) / PVS_SAMPLES,
+                                       col + (z + 0.5f) / PVS_SAMPLES, PVS_RAYS);
+            }
+        }
+
+        uint8_t* set = grid.pvs + index * grid.pvs_stride;
+        for (size_t i = 0; i < cels; i++) {
+            set[i / 8] |= (visibility.stamps[i] == visibility.frame) << (i % 8);
+        }
+    }
+
+    visibility_free(&visibility);
+    return NULL;
+}
+
+// Offline: bakes, for every walkable cel, the cels visible from anywhere in it
+// and stores them in the grid, to be saved with the binary map.
+void pvs_build(Grid* grid, TileRenderer* tiles) {
+    size_t cels = grid->rows * grid->cols;
+    if (cels > PVS_CELS_MAX) {
+        printf("[ERROR] Map too big for a visibility set: %zu cels, max: %d\n", cels, PVS_CELS_MAX);
+        exit(EXIT_FAILURE);
+    }
+
+    grid_detach(grid);
+    free(grid->pvs);
+    grid->pvs_stride = (cels + 7) / 8;
+    grid->pvs_solid  = tiles->solid;
+    grid->pvs        = (uint8_t*)calloc(cels, grid->pvs_stride);
+
+    PvsJob job = {0};
+    job.grid   = *grid;
+    job.tiles  = tiles;
+    atomic_init(&job.next, 0);
+
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    threads      = threads < 1 ? 1 : (threads > PVS_THREADS_MAX ? PVS_THREADS_MAX : threads);
+    pthread_t workers[PVS_THREADS_MAX];
+    for (long i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, pvs_worker, &job) != 0) {
+            printf("[ERROR] Could not start a visibility worker\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (long i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "map.h"
+#include "tiles.h"
+
+// Beyond this the sets of every cel against every cel get too big to ship.
+#define PVS_CELS_MAX (128 * 128)
+#define PVS_SAMPLES 3
+#define PVS_RAYS 720
+
+void pvs_build(Grid* grid, TileRenderer* tiles);
+
+// Bit per cel, row-major, of the cels visible from (row, col). Solid cels have an empty set.
+static inline const uint8_t* pvs_set(Grid grid, size_t row, size_t col) {
+    return grid.pvs + (row * grid.cols + col) * grid.pvs_stride;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define SPSC_QUEUE_CAPACITY 64
+
+typedef struct SpscQueue SpscQueue;
+
+// Lock-free ring of pointers between exactly one producer thread and one
+// consumer thread. head is only written by the consumer, tail by the producer.
+struct SpscQueue {
+    void* items[SPSC_QUEUE_CAPACITY];
+    atomic_size_t head;
+    atomic_size_t tail;
+};
+
+static inline void spsc_init(SpscQueue* queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+// false when the queue is full
+static inline bool spsc_push(SpscQueue* queue, void* item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == SPSC_QUEUE_CAPACITY) {
+        return false;
+    }
+    queue->items[tail % SPSC_QUEUE_CAPACITY] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// NULL when the queue is empty
+static inline void* spsc_pop(SpscQueue* queue) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    void* item = queue->items[head % SPSC_QUEUE_CAPACITY];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return item;
+}
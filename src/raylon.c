@@ -2,8 +2,21 @@
 #include "stdlib.h"
 #include "stdbool.h"
 #include "stdio.h"
+#include "string.h"
 #include "math.h"
 #include "map.h"
+#include "tiles.h"
+#include "bake.h"
+#include "stream.h"
+#include "cull.h"
+#include "visibility.h"
+#include "softrender.h"
+#include "font_cache.h"
+#include "mesh_cache.h"
+#include "loader.h"
+#include "assets.h"
+#include "lru.h"
+#include "hash.h"
 
 #include "emotional_text.h"
 
@@ -11,8 +24,14 @@
 #include "rlights.h"
 
 #define FONTS 10
+#define MAP_PATH "src/map_01"
+#define MAP_BINARY_PATH "build/map_01.rlmp"
+#define MAP_STREAM_PATH "build/map_01.chunks"
 #define W 1920
 #define H 1080
+#define TYPEWRITER_SPEED 40.0f // glyphs per second
+#define TYPEWRITER_FAST 4.0f
+#define DIALOGUE_WIDTH 560.0f
 
 void UpdateCameraRelative(Camera *camera, double deltaTime, int velocity) {
     // Update camera movement/rotation
@@ -41,6 +60,16 @@ typedef enum {
     PAUSED,
 } StatusGlobalGame;
 
+typedef enum {
+    RENDER_INSTANCED,
+    RENDER_BAKED,
+    RENDER_STREAMED,
+    RENDER_SOFTWARE,
+    RENDER_MODES,
+} RenderMode;
+
+const char* RENDER_MODE_NAMES[RENDER_MODES] = {"instanced", "baked", "streamed", "software"};
+
 typedef struct {
     Font font;
     float line_spc;
@@ -50,13 +79,44 @@ typedef struct {
 
 #define FONT_SPACE_RATIO 1.14
 #define FONT_SPACE 1
-FontGame LoadFontGame(const char* path, int size) {
+// font loaded at size, see loader_add_font
+FontGame FontGameNew(Font font, int size) {
     float line_spc  = size * FONT_SPACE_RATIO;
-    Font font = LoadFontEx(path, size, NULL, 0);
 
     return (FontGame){font, line_spc, FONT_SPACE, size};
 }
 
+// Same face at another size, sharing the atlas
+FontGame FontGameSize(FontGame font, int size) {
+    font.line_spc = size * FONT_SPACE_RATIO;
+    font.size = size;
+    return font;
+}
+
+#define FONT_SDF_SIZE 32
+#define FONT_SDF_GLYPHS 95
+// Distance field atlas rasterized once at FONT_SDF_SIZE, sharp at any size
+// with shader/emotional_text_sdf.fs, use FontGameSize for the other sizes
+FontGame FontGameNewSDF(Font font, int size) {
+    SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+
+    SetEmotionalTextFontSdf(font);
+    return FontGameSize((FontGame){font, 0.0f, FONT_SPACE, 0}, size);
+}
+
+// Fonts sharing an atlas are unloaded once
+void UnloadFontGames(FontGame* fonts, int count) {
+    for (int i = 0; i < count; i++) {
+        bool shared = false;
+        for (int j = 0; j < i; j++) {
+            shared = shared || (fonts[j].font.texture.id == fonts[i].font.texture.id);
+        }
+        if (!shared && (fonts[i].font.texture.id != 0)) {
+            UnloadFont(fonts[i].font);
+        }
+    }
+}
+
 static struct {
     float text_box_margin;
     float box_border;
@@ -66,9 +126,73 @@ static struct {
 
 #define BORDER_THICK 2.5f
 
-Vector2 GuiGameMeasureText(const char* text, FontGame font) {
+#define GUI_GAME_LAYOUT_CACHE_SIZE 128
+
+typedef struct {
+    LruKey key;
+    char* text;
+    FontGame font;
+    Vector2 size;
+} GuiGameLayout;
+
+typedef struct {
+    const char* text;
+    FontGame font;
+} GuiGameLayoutSource;
+
+// Measured texts by hash of (font, size, spacing, text), least recently used replaced
+static struct {
+    GuiGameLayout entries[GUI_GAME_LAYOUT_CACHE_SIZE];
+    Lru lru;
+    unsigned long hits;
+    unsigned long misses;
+} GuiGameLayoutCache = {.lru = {GuiGameLayoutCache.entries, sizeof(GuiGameLayout), GUI_GAME_LAYOUT_CACHE_SIZE}};
+
+static unsigned long long GuiGameLayoutHash(const char* text, FontGame font) {
+    unsigned int line_spc;
+    memcpy(&line_spc, &font.line_spc, sizeof(line_spc));
+    unsigned int keys[4] = {font.font.texture.id, (unsigned int)font.size, (unsigned int)font.letter_spc, line_spc};
+    return hash_bytes(hash_string(HASH_OFFSET, text), keys, sizeof(keys));
+}
+
+static bool GuiGameLayoutSame(const void* entry, const void* key) {
+    const GuiGameLayout* layout = (const GuiGameLayout*)entry;
+    const GuiGameLayoutSource* source = (const GuiGameLayoutSource*)key;
+    return (layout->font.font.texture.id == source->font.font.texture.id) && (layout->font.size == source->font.size) &&
+           (layout->font.letter_spc == source->font.letter_spc) && (layout->font.line_spc == source->font.line_spc) &&
+           (strcmp(layout->text, source->text) == 0);
+}
+
+static void GuiGameLayoutUnload(void* entry) {
+    free(((GuiGameLayout*)entry)->text);
+}
+
+GuiGameLayout* GuiGameLayoutText(const char* text, FontGame font) {
+    GuiGameLayoutSource source = {text, font};
+    unsigned long long hash = GuiGameLayoutHash(text, font);
+    GuiGameLayout* entry = (GuiGameLayout*)lru_find(&GuiGameLayoutCache.lru, hash, GuiGameLayoutSame, &source);
+    if (entry) {
+        GuiGameLayoutCache.hits++;
+        return entry;
+    }
+    GuiGameLayoutCache.misses++;
+
+    entry = (GuiGameLayout*)lru_insert(&GuiGameLayoutCache.lru, hash, GuiGameLayoutUnload);
+    int length = TextLength(text);
+    entry->text = (char*)malloc(length + 1);
+    memcpy(entry->text, text, length + 1);
+    entry->font = font;
     SetTextLineSpacing(font.line_spc);
-    return MeasureTextEx(font.font, text, font.size , font.letter_spc);
+    entry->size = MeasureTextEx(font.font, text, font.size, font.letter_spc);
+    return entry;
+}
+
+void GuiGameLayoutCacheFree(void) {
+    lru_clear(&GuiGameLayoutCache.lru, GuiGameLayoutUnload);
+}
+
+Vector2 GuiGameMeasureText(const char* text, FontGame font) {
+    return GuiGameLayoutText(text, font)->size;
 }
 
 Rectangle GuiGameTextBoxMeasure(const char* text, Vector2 pos, FontGame font) {
@@ -96,34 +220,218 @@ void GuiGameDrawTextBox(const char* text, Vector2 pos, FontGame font, Color colo
     DrawEmotionalText(font.font, text, (Vector2){pos.x, pos.y}, font.size, font.letter_spc, color_text);
 };
 
-void GuiGameDrawSubTextBox(const char* text, int position, Vector2 pos, FontGame font, Color color, Color color_text) {
+// Box sized for the whole text, with only the first glyphs written
+void GuiGameDrawSubTextBox(const char* text, int glyphs, Vector2 pos, FontGame font, Color color, Color color_text) {
     Rectangle text_box = GuiGameTextBoxMeasure(text, pos, font);
     GuiGameDrawBorder(text_box, Fade(color, 0.7f));
 
     DrawRectangleRec(text_box, color);
-    DrawEmotionalText(font.font, TextSubtext(text, 0, position), (Vector2){pos.x, pos.y}, font.size, font.letter_spc, color_text);
+    DrawEmotionalTextReveal(font.font, text, glyphs, (Vector2){pos.x, pos.y}, font.size, font.letter_spc, color_text);
 };
 
-bool GuiGameDrawButton(const char* text, FontGame font, Vector2 pos, Color color, Color color_text) {
+// Hover and click of a button, without drawing it
+bool GuiGameUpdateButton(const char* text, FontGame font, Vector2 pos, bool* is_hover) {
     bool is_active = false;
     Rectangle text_box = GuiGameTextBoxMeasure(text, pos, font);
+
+    *is_hover = CheckCollisionPointRec(GetMousePosition(), text_box);
+    if (*is_hover && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)){
+        PlaySound(*GuiGameStyle.sound_click);
+        is_active = true;
+    }
+    return is_active;
+}
+
+void GuiGameDrawButtonState(const char* text, FontGame font, Vector2 pos, Color color, Color color_text, bool is_hover) {
+    Rectangle text_box = GuiGameTextBoxMeasure(text, pos, font);
     GuiGameDrawBorder(text_box, Fade(color, 0.7f));
 
-    bool is_hover = CheckCollisionPointRec(GetMousePosition(), text_box);
     if (is_hover){
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)){
-            PlaySound(*GuiGameStyle.sound_click);
-            is_active = true;
-        }
         color = ColorBrightness(color, 0.4);
     }
 
     DrawRectangleRec(text_box, color);
     DrawEmotionalText(font.font, text, pos, font.size, font.letter_spc, color_text);
+}
 
+bool GuiGameDrawButton(const char* text, FontGame font, Vector2 pos, Color color, Color color_text) {
+    bool is_hover;
+    bool is_active = GuiGameUpdateButton(text, font, pos, &is_hover);
+    GuiGameDrawButtonState(text, font, pos, color, color_text, is_hover);
     return is_active;
 }
 
+#define GUI_GAME_LAYER_WIDGETS 32
+#define GUI_GAME_LAYER_TEXT 4096
+#define GUI_GAME_LAYER_MARGIN 4.0f // room for the ~wave~ glyphs out of their box
+#define GUI_GAME_LAYER_ALIGN 64    // texture sizes grow in these steps
+
+typedef enum {
+    GUI_GAME_TEXT_BOX,
+    GUI_GAME_BUTTON,
+} GuiGameWidgetKind;
+
+typedef struct {
+    GuiGameWidgetKind kind;
+    int text; // offset in the layer text
+    Vector2 pos;
+    FontGame font;
+    Color color;
+    Color color_text;
+    bool is_hover;
+} GuiGameWidget;
+
+// Widgets recorded every frame and drawn into a render texture only when the
+// record differs from the one drawn last, or shows an animated text. The
+// texture covers the bounds of the widgets, holds premultiplied alpha and is
+// put on screen as a single quad. Only widgets that rarely change belong in a
+// layer, text changing every frame is cheaper drawn directly.
+typedef struct {
+    RenderTexture2D target;
+    Rectangle bounds; // on screen, of the widgets last drawn
+    GuiGameWidget widgets[GUI_GAME_LAYER_WIDGETS];
+    int widgets_count;
+    char text[GUI_GAME_LAYER_TEXT]; // copies, TextFormat buffers do not last the frame
+    int text_size;
+    unsigned long long drawn;
+    bool animated;
+    unsigned long redraws;
+} GuiGameLayer;
+
+// The texture is made on the first draw, at the size of the widgets
+GuiGameLayer GuiGameLayerNew(void) {
+    GuiGameLayer layer = {0};
+    return layer;
+}
+
+void GuiGameLayerBegin(GuiGameLayer* layer) {
+    layer->widgets_count = 0;
+    layer->text_size = 0;
+    layer->animated = false;
+}
+
+static GuiGameWidget* GuiGameLayerRecord(GuiGameLayer* layer, GuiGameWidgetKind kind, const char* text) {
+    int length = TextLength(text);
+    if ((layer->widgets_count == GUI_GAME_LAYER_WIDGETS) || (layer->text_size + length + 1 > GUI_GAME_LAYER_TEXT)) {
+        printf("[ERROR] Too many widgets in a GUI layer: %s\n", text);
+        exit(EXIT_FAILURE);
+    }
+    GuiGameWidget* widget = &layer->widgets[layer->widgets_count++];
+    *widget = (GuiGameWidget){0};
+    widget->kind = kind;
+    widget->text = layer->text_size;
+    memcpy(layer->text + layer->text_size, text, length + 1);
+    layer->text_size += length + 1;
+    layer->animated = layer->animated || IsEmotionalTextAnimated(text);
+    return widget;
+}
+
+void GuiGameLayerTextBox(GuiGameLayer* layer, const char* text, Vector2 pos, FontGame font, Color color, Color color_text) {
+    GuiGameWidget* widget = GuiGameLayerRecord(layer, GUI_GAME_TEXT_BOX, text);
+    widget->pos = pos;
+    widget->font = font;
+    widget->color = color;
+    widget->color_text = color_text;
+}
+
+bool GuiGameLayerButton(GuiGameLayer* layer, const char* text, FontGame font, Vector2 pos, Color color, Color color_text) {
+    bool is_hover;
+    bool is_active = GuiGameUpdateButton(text, font, pos, &is_hover);
+    GuiGameWidget* widget = GuiGameLayerRecord(layer, GUI_GAME_BUTTON, text);
+    widget->pos = pos;
+    widget->font = font;
+    widget->color = color;
+    widget->color_text = color_text;
+    widget->is_hover = is_hover;
+    return is_active;
+}
+
+static unsigned long long GuiGameLayerHash(GuiGameLayer* layer) {
+    unsigned long long hash = hash_bytes(HASH_OFFSET, layer->text, layer->text_size);
+    for (int i = 0; i < layer->widgets_count; i++) {
+        GuiGameWidget w = layer->widgets[i];
+        float fields[6] = {w.pos.x, w.pos.y, w.font.line_spc, (float)w.font.size, (float)w.font.letter_spc,
+                           (float)w.font.font.texture.id};
+        unsigned int keys[10] = {w.kind, w.is_hover, ColorToInt(w.color), ColorToInt(w.color_text)};
+        memcpy(&keys[4], fields, sizeof(fields));
+        hash = hash_bytes(hash, keys, sizeof(keys));
+    }
+    return hash;
+}
+
+static Rectangle GuiGameLayerBounds(GuiGameLayer* layer) {
+    float left = 0.0f;
+    float top = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+    for (int i = 0; i < layer->widgets_count; i++) {
+        GuiGameWidget w = layer->widgets[i];
+        Rectangle box = GuiGameTextBoxMeasure(layer->text + w.text, w.pos, w.font);
+        float margin = GuiGameStyle.box_border + GUI_GAME_LAYER_MARGIN;
+        if ((i == 0) || (box.x - margin < left)) left = box.x - margin;
+        if ((i == 0) || (box.y - margin < top)) top = box.y - margin;
+        if ((i == 0) || (box.x + box.width + margin > right)) right = box.x + box.width + margin;
+        if ((i == 0) || (box.y + box.height + margin > bottom)) bottom = box.y + box.height + margin;
+    }
+    left = floorf(left);
+    top = floorf(top);
+    return (Rectangle){left, top, ceilf(right - left), ceilf(bottom - top)};
+}
+
+// Redraws the texture when needed and puts it on screen
+void GuiGameLayerEnd(GuiGameLayer* layer) {
+    if (layer->widgets_count == 0) {
+        return;
+    }
+    unsigned long long hash = GuiGameLayerHash(layer);
+    if ((hash != layer->drawn) || layer->animated || (layer->redraws == 0)) {
+        layer->bounds = GuiGameLayerBounds(layer);
+        int width = (int)layer->bounds.width;
+        int height = (int)layer->bounds.height;
+        if ((width > layer->target.texture.width) || (height > layer->target.texture.height)) {
+            if (layer->target.id != 0) {
+                UnloadRenderTexture(layer->target);
+            }
+            width = (width + GUI_GAME_LAYER_ALIGN - 1) / GUI_GAME_LAYER_ALIGN * GUI_GAME_LAYER_ALIGN;
+            height = (height + GUI_GAME_LAYER_ALIGN - 1) / GUI_GAME_LAYER_ALIGN * GUI_GAME_LAYER_ALIGN;
+            layer->target = LoadRenderTexture(width, height);
+        }
+
+        BeginTextureMode(layer->target);
+        ClearBackground(BLANK);
+        // widgets keep their screen positions, moved to the texture corner
+        rlTranslatef(-layer->bounds.x, -layer->bounds.y, 0.0f);
+        rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+        BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+        for (int i = 0; i < layer->widgets_count; i++) {
+            GuiGameWidget w = layer->widgets[i];
+            const char* text = layer->text + w.text;
+            if (w.kind == GUI_GAME_BUTTON) {
+                GuiGameDrawButtonState(text, w.font, w.pos, w.color, w.color_text, w.is_hover);
+            } else {
+                GuiGameDrawTextBox(text, w.pos, w.font, w.color, w.color_text);
+            }
+        }
+        EndBlendMode();
+        EndTextureMode();
+        layer->drawn = hash;
+        layer->redraws++;
+    }
+
+    // the bounds are in the top rows of the texture, which is upside down
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    Texture2D texture = layer->target.texture;
+    Rectangle source = {0, texture.height - layer->bounds.height, layer->bounds.width, -layer->bounds.height};
+    DrawTextureRec(texture, source, (Vector2){layer->bounds.x, layer->bounds.y}, WHITE);
+    EndBlendMode();
+}
+
+void GuiGameLayerFree(GuiGameLayer* layer) {
+    if (layer->target.id != 0) {
+        UnloadRenderTexture(layer->target);
+    }
+}
+
 typedef struct {
     Camera3D camera;
     CameraMode active_mode;
@@ -187,14 +495,14 @@ void UpdateCameraGameOrtho(CameraGame* camera, Camera data) {
 }
 
 FontGame DEBUG_FONT;
-void DebugCameraGame(CameraGame *camera, Vector2 pos) {
-    GuiGameDrawTextBox(TextFormat("Pos: %.1f %.1f %.1f",
+void DebugCameraGame(GuiGameLayer* layer, CameraGame *camera, Vector2 pos) {
+    GuiGameLayerTextBox(layer, TextFormat("Pos: %.1f %.1f %.1f",
                               camera->camera.position.x,
                               camera->camera.position.y,
                               camera->camera.position.z),
                    pos, DEBUG_FONT, DARKGREEN, WHITE);
-    GuiGameDrawTextBox(TextFormat("FOV: %.1f", camera->camera.fovy), (Vector2){pos.x, pos.y + 40}, DEBUG_FONT, DARKGREEN, WHITE);
-    GuiGameDrawTextBox(TextFormat("Target: %.1f %1.f %.1f",
+    GuiGameLayerTextBox(layer, TextFormat("FOV: %.1f", camera->camera.fovy), (Vector2){pos.x, pos.y + 40}, DEBUG_FONT, DARKGREEN, WHITE);
+    GuiGameLayerTextBox(layer, TextFormat("Target: %.1f %1.f %.1f",
                               camera->camera.target.x,
                               camera->camera.target.y,
                               camera->camera.target.z),
@@ -210,6 +518,19 @@ typedef struct {
     Vector2 last_pos;
 } CursorGame;
 
+// Progress bar while the loader threads decode, only the default font is ready.
+// The model textures are only known after the first pass, they get a bar of their own.
+void DrawLoadingScreen(int pass, int loaded, int total, void* user) {
+    float progress = total > 0 ? (float)loaded / total : 1.0f;
+    const char* what = pass == 0 ? "Loading" : "Loading model textures";
+    BeginDrawing();
+    ClearBackground(BLACK);
+    DrawText(TextFormat("%s %d/%d", what, loaded, total), W / 4, H / 2 - 30, 20, WHITE);
+    DrawRectangle(W / 4, H / 2, (int)(W / 2 * progress), 20, DARKGREEN);
+    DrawRectangleLines(W / 4, H / 2, W / 2, 20, DARKGREEN);
+    EndDrawing();
+}
+
 int main(void) {
     char *window_title = "Raylon - running";
     SetConfigFlags(FLAG_MSAA_4X_HINT);  // Enable Multi Sampling Anti Aliasing 4x (if available)
@@ -219,76 +540,128 @@ int main(void) {
     bool show_mouse = true;
     bool fps_cap = true;
 
+    InitAudioDevice();
+
+    // models and textures loaded once and shared, the retextured walls
+    // draw the meshes of wall
+    Assets* assets = assets_new();
+    int wall_asset = assets_model(assets, "models/medieval01/wall.obj");
+    int wall_doom_asset = assets_model_retextured(assets, wall_asset, "textures/doom.png");
+    int wall_wolf_asset = assets_model_retextured(assets, wall_asset, "textures/wolf.png");
+    int wall_fortified_asset = assets_model(assets, "models/medieval01/wallFortified.obj");
+    int wall_fortified_gate_asset = assets_model(assets, "models/medieval01/wallFortified_gate.obj");
+    int tower_asset = assets_model(assets, "models/medieval01/tower.obj");
+    int floor_asset = assets_model(assets, "models/medieval01/floor.obj");
+    int column_asset = assets_model(assets, "models/medieval01/column.obj");
+    int cross_asset = assets_texture(assets, "textures/crosshair.png");
+    int cursor_asset = assets_texture(assets, "textures/cursor.png");
+    int heroin_asset = assets_texture(assets, "textures/heroin.png");
+
+    // the other files decoded on the same loader threads, uploaded here as they are ready
+    Font mono_bold = {0};
+    Font alagard = {0};
+    Sound click = {0};
+    // walls of the CPU raycaster, by tile
+    const char* soft_paths[] = {"models/medieval01/Textures/stones.png",
+                                "models/medieval01/Textures/stonesPainted.png",
+                                "textures/doom.png", "textures/wall.png", "textures/wolf.png",
+                                "models/medieval01/Textures/planks.png"};
+    Image soft_images[sizeof(soft_paths) / sizeof(soft_paths[0])] = {0};
+
+    Loader* loader = loader_new();
+    loader_add_font(loader, &mono_bold, "fonts/mono-bold.ttf", FONT_SDF_SIZE, FONT_SDF_GLYPHS, FONT_SDF);
+    loader_add_font(loader, &alagard, "fonts/alagard.ttf", 20, 0, FONT_DEFAULT);
+    loader_add_sound(loader, &click, "sounds/click_004.ogg");
+    for (size_t i = 0; i < sizeof(soft_paths) / sizeof(soft_paths[0]); i++) {
+        loader_add_image(loader, &soft_images[i], soft_paths[i]);
+    }
+    assets_load(assets, loader, DrawLoadingScreen, NULL);
+    loader_free(loader);
+
+    Model* wall = assets_get_model(assets, wall_asset);
+    Model* wallDoom = assets_get_model(assets, wall_doom_asset);
+    Model* wallWolf = assets_get_model(assets, wall_wolf_asset);
+    Model* wallFortified = assets_get_model(assets, wall_fortified_asset);
+    Model* wallFortifiedGate = assets_get_model(assets, wall_fortified_gate_asset);
+    Model* tower = assets_get_model(assets, tower_asset);
+    Model* floor = assets_get_model(assets, floor_asset);
+    Model* column = assets_get_model(assets, column_asset);
+    Texture2D cross = assets_get_texture(assets, cross_asset);
+    Texture2D cursor = assets_get_texture(assets, cursor_asset);
+    Texture2D heroin = assets_get_texture(assets, heroin_asset);
+
     FontGame fonts[FONTS] = { 0 };
-    fonts[0] = LoadFontGame("fonts/mono-bold.ttf", 20);
-    fonts[1] = LoadFontGame("fonts/alagard.ttf", 20);
+    fonts[0] = FontGameNewSDF(mono_bold, 20);
+    fonts[1] = FontGameNew(alagard, 20);
+    fonts[2] = FontGameSize(fonts[0], 18);
 
-    DEBUG_FONT = fonts[1];
+    // codepoints past ASCII are rasterized on first use, see emotional_text.h
+    const char* mono_chain[] = {"fonts/mono-bold.ttf", "fonts/mono.ttf"};
+    const char* alagard_chain[] = {"fonts/alagard.ttf", "fonts/mono.ttf"};
+    SetEmotionalTextFontChain(fonts[0].font, mono_chain, 2);
+    SetEmotionalTextFontChain(fonts[1].font, alagard_chain, 2);
+
+    DEBUG_FONT = fonts[2];
+
+    // widgets drawn again only when they change, see GuiGameLayer
+    GuiGameLayer hud   = GuiGameLayerNew();
+    GuiGameLayer debug = GuiGameLayerNew();
+
+    // emotional text quads stay on the GPU, ~wave~ is animated by the shader
+    Shader text_shader = LoadShader("shader/emotional_text.vs", NULL);
+    Shader text_sdf_shader = LoadShader("shader/emotional_text.vs", "shader/emotional_text_sdf.fs");
+    SetEmotionalTextShader(text_shader);
+    SetEmotionalTextSdfShader(text_sdf_shader);
+    SetEmotionalTextOutline(0.2f, BLACK);
 
-    InitAudioDevice();
-    Sound click = LoadSound("sounds/click_004.ogg");
     SetSoundVolume(click, 1.0f);
     GuiGameStyle.sound_click = &click;
 
-    unsigned int p = 0;
-    const char *message = "**Life** isn't just about passing on your genes. \n"
-        "We can leave behind much more than just DNA. \n"
-        "Through speech, music, literature and movies... \n"
-        "what we've seen, heard, felt anger, joy and sorrow, \n"
-        "these are the things I will pass on. \n"
-        "~That's what I live for. ~\n"
-        "We need to pass the torch, and let our \n"
-        "children read our messy and sad history by its light. \n"
-        "We have the magic of the digital age to do that \n"
-        "with. The human race will probably come to an end \n"
-        "some time, and new species may rule over this \n"
-        "planet. Earth may not be forever, but we still have \n"
-        "the responsibility to leave what trace of life we \n"
-        "can. Building the future and keeping the past alive \n"
-        "are one in the same thing.";
+    float revealed = 0.0f; // glyphs of the message typed so far
+    // wrapped at the dialogue width, see EmotionalFlow
+    Font message_font = fonts[1].font;
+    EmotionalFlow message = LoadEmotionalFlow(message_font, message_font, message_font, message_font, fonts[1].size, 1,
+                                              fonts[1].letter_spc, DIALOGUE_WIDTH);
+    AppendEmotionalFlow(&message, "**Life** isn't just about passing on your genes. "
+        "We can leave behind much more than just DNA. "
+        "Through speech, music, literature and movies... "
+        "what we've seen, heard, felt anger, joy and sorrow, "
+        "these are the things I will pass on.\n"
+        "~That's what I live for.~\n"
+        "We need to pass the torch, and let our "
+        "children read our messy and sad history by its light. "
+        "We have the magic of the digital age to do that "
+        "with. The human race will probably come to an end "
+        "some time, and new species may rule over this "
+        "planet. Earth may not be forever, but we still have "
+        "the responsibility to leave what trace of life we "
+        "can. Building the future and keeping the past alive "
+        "are one in the same thing.");
 
     CameraGame camera_game = NewCameraGamePerspective();
     CameraGame last_camera_gamer = NewCameraGameOrtho();
 
-    int size = 4;
-    Model wall = LoadModel("models/medieval01/wall.obj");
-    Model wallDoom = LoadModelFromMesh(wall.meshes[0]);
-    Model wallWolf = LoadModelFromMesh(wall.meshes[0]);
-    Model wallFortified = LoadModel("models/medieval01/wallFortified.obj");
-    Model wallFortifiedGate = LoadModel("models/medieval01/wallFortified_gate.obj");
-    Model tower = LoadModel("models/medieval01/tower.obj");
-    Model floor = LoadModel("models/medieval01/floor.obj");
-    Model column = LoadModel("models/medieval01/column.obj");
-
-    GenTextureMipmaps(&wall.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
-    GenTextureMipmaps(&wallFortified.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
-    GenTextureMipmaps(&wallFortifiedGate.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
-    GenTextureMipmaps(&tower.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
-    GenTextureMipmaps(&floor.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
-    GenTextureMipmaps(&column.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
-
-    SetTextureFilter(wall.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-    SetTextureFilter(wallFortified.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-    SetTextureFilter(wallFortifiedGate.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-    SetTextureFilter(tower.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-    SetTextureFilter(floor.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-
-    Texture2D doom = LoadTexture("textures/doom.png");
-    Texture2D wolf = LoadTexture("textures/wolf.png");
-    SetTextureFilter(doom, TEXTURE_FILTER_ANISOTROPIC_16X);
-    SetTextureFilter(wolf, TEXTURE_FILTER_ANISOTROPIC_16X);
-
-    wallDoom.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = doom;
-    wallWolf.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = wolf;
+    GenTextureMipmaps(&wall->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+    GenTextureMipmaps(&wallFortified->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+    GenTextureMipmaps(&wallFortifiedGate->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+    GenTextureMipmaps(&tower->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+    GenTextureMipmaps(&floor->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+    GenTextureMipmaps(&column->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+
+    SetTextureFilter(wall->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+    SetTextureFilter(wallFortified->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+    SetTextureFilter(wallFortifiedGate->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+    SetTextureFilter(tower->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+    SetTextureFilter(floor->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+
+    SetTextureFilter(wallDoom->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+    SetTextureFilter(wallWolf->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture, TEXTURE_FILTER_ANISOTROPIC_16X);
 
     // wall.materials[0].shader = shader;
     // floor.materials[0].shader = shader;
     // column.materials[0].shader = shader;
     // light.materials[0].shader = shader;
 
-    Texture2D cross = LoadTexture("textures/crosshair.png");
-    Texture2D cursor = LoadTexture("textures/cursor.png");
-
     // Ray ray = { 0 }; // Picking line ray
     // int velocity = 80;
 
@@ -300,8 +673,75 @@ int main(void) {
         SetTargetFPS(0);
     }
 
-    Texture heroin = LoadTexture("textures/heroin.png");
-    Grid map_file = grid_load("src/map_01");
+    Grid map_file = grid_load(FileExists(MAP_BINARY_PATH) ? MAP_BINARY_PATH : MAP_PATH);
+
+    // map tiles, grouped by model and drawn instanced
+    TileRenderer tiles = tiles_new(LoadShader("shader/instancing.vs", NULL));
+    tiles_define(&tiles, 0, (TilePart){floor, -0.2f});
+    tiles_define_empty(&tiles, 1);
+    tiles_define(&tiles, 2, (TilePart){wallFortified, 0.0f});
+    tiles_define(&tiles, 3, (TilePart){floor, -0.2f});
+    tiles_define(&tiles, 3, (TilePart){wallFortifiedGate, 0.0f});
+    tiles_define(&tiles, 4, (TilePart){floor, -0.2f});
+    tiles_define(&tiles, 4, (TilePart){tower, 0.0f});
+    tiles_define(&tiles, 5, (TilePart){wallDoom, 0.0f});
+    tiles_define(&tiles, 6, (TilePart){floor, -0.2f});
+    tiles_define(&tiles, 6, (TilePart){column, 0.2f});
+    tiles_define(&tiles, 8, (TilePart){wallWolf, 0.0f});
+    tiles_define_empty(&tiles, 9);
+    tiles_define_fallback(&tiles, (TilePart){wall, 0.0f});
+    if (map_file.pvs_solid) {
+        // the ones the visibility set was baked with, see make maps
+        tiles.solid = map_file.pvs_solid;
+    } else {
+        tiles_set_solid(&tiles, 5);
+        tiles_set_solid(&tiles, 7);
+        tiles_set_solid(&tiles, 8);
+    }
+
+    // static map, merged by material per chunk with the buried faces removed
+    Shader baked_shader = { 0 };
+    if (BAKE_QUANTIZE) {
+        // the chunks keep their normals packed, see mesh_quant_upload
+        baked_shader = LoadShader("shader/lighting_quantized.vs", "shader/lighting.fs");
+        baked_shader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(baked_shader, "viewPos");
+        float ambient[4] = { 4.0f, 4.0f, 4.0f, 1.0f };
+        SetShaderValue(baked_shader, GetShaderLocation(baked_shader, "ambient"), ambient, SHADER_UNIFORM_VEC4);
+        CreateLight(LIGHT_DIRECTIONAL, (Vector3){ 1.0f, 4.0f, 2.0f }, (Vector3){ 0 }, WHITE, baked_shader);
+        bake_set_shader(baked_shader);
+    }
+    BakedWorld baked = bake_world(map_file, &tiles);
+    RenderMode render_mode = RENDER_BAKED;
+
+    // cels seen from the camera in first person, baked with the binary map (make maps)
+    // or cast every frame, only the instanced path uses them
+    Visibility visibility = visibility_new(map_file);
+    bool       occlusion  = true;
+
+    // chunked copy of the map, paged around the camera (make maps)
+    Stream* stream = NULL;
+    if (FileExists(MAP_STREAM_PATH)) {
+        stream = stream_open(MAP_STREAM_PATH, &tiles);
+    }
+
+    // CPU raycaster at a quarter of the screen, scaled up when drawn
+    SoftRenderer soft = soft_new(W / 4, H / 4);
+    soft_set_wall(&soft, 2, soft_images[0]);
+    soft_set_wall(&soft, 3, soft_images[0]);
+    soft_set_wall(&soft, 4, soft_images[1]);
+    soft_set_wall(&soft, 5, soft_images[2]);
+    soft_set_wall(&soft, 8, soft_images[4]);
+    // the same empty tiles and fallback wall as the instanced tiles
+    soft_set_empty(&soft, 0);
+    soft_set_empty(&soft, 1);
+    soft_set_empty(&soft, 6);
+    soft_set_empty(&soft, 9);
+    soft_set_wall_fallback(&soft, soft_images[3]);
+    soft_set_floor(&soft, soft_images[5]);
+    for (size_t i = 0; i < sizeof(soft_images) / sizeof(soft_images[0]); i++) {
+        UnloadImage(soft_images[i]);
+    }
+    Texture2D soft_frame = LoadTextureFromImage(soft_image(&soft));
 
     while (!WindowShouldClose()) {
         if (IsKeyPressed(KEY_Z)) {
@@ -317,6 +757,17 @@ int main(void) {
             }
         }
 
+        if (IsKeyPressed(KEY_TAB)) {
+            render_mode = (render_mode + 1) % RENDER_MODES;
+            if ((render_mode == RENDER_STREAMED) && !stream) {
+                render_mode = (render_mode + 1) % RENDER_MODES;
+            }
+        }
+
+        if (IsKeyPressed(KEY_O)) {
+            occlusion = !occlusion;
+        }
+
         if (IsKeyPressed(KEY_LEFT_SHIFT)) {
             show_mouse = !show_mouse;
         }
@@ -326,41 +777,40 @@ int main(void) {
             SetMousePosition(W / 2, H / 2);
         }
 
+        if (stream) {
+            stream_update(stream, camera_game.camera.position);
+        }
+
+        float     aspect     = (float)GetScreenWidth() / GetScreenHeight();
+        Frustum   frustum    = frustum_from_camera(camera_game.camera, aspect);
+        CullStats cull_stats = {0};
+        bool      occluded   = occlusion && (render_mode == RENDER_INSTANCED) &&
+                          (visibility_use_pvs(&visibility, map_file, camera_game.camera) ||
+                           visibility_cast(&visibility, map_file, &tiles, camera_game.camera, aspect));
+
+        if (render_mode == RENDER_SOFTWARE) {
+            soft_render(&soft, map_file, camera_game.camera);
+            UpdateTexture(soft_frame, soft.pixels);
+        }
+
+        if (BAKE_QUANTIZE) {
+            SetShaderValue(baked_shader, baked_shader.locs[SHADER_LOC_VECTOR_VIEW], &camera_game.camera.position,
+                           SHADER_UNIFORM_VEC3);
+        }
+
         BeginDrawing();
         ClearBackground(BLACK);
         BeginMode3D(camera_game.camera);
 
         // map
-        // TODO generate entities to not draws over map every frame, but over entities (batch rendering).
-        // TODO push a smart algorith, for now, with smol number of itens, its ok
-        for (size_t x = 0; x < map_file.rows; x++) {
-            for (size_t y = 0; y < map_file.cols; y++) {
-                Cel cel = map_file.cels[x][y];
-                if (cel.raw_value == 0) {
-                    DrawModel(floor, (Vector3){x * size, -0.2f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 1) {
-                    //
-                } else if (cel.raw_value == 2) {
-                    DrawModel(wallFortified, (Vector3){x * size, 0.0f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 3) {
-                    DrawModel(floor,(Vector3){x * size, -0.2f, y * size}, size, WHITE);
-                    DrawModel(wallFortifiedGate, (Vector3){x * size, 0.0f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 4) {
-                    DrawModel(floor,(Vector3){x * size, -0.2f, y * size}, size, WHITE);
-                    DrawModel(tower, (Vector3){x * size, 0.0f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 5) {
-                    DrawModel(wallDoom, (Vector3){x * size, 0.0f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 6) {
-                    DrawModel(floor, (Vector3){x * size, -0.2f, y * size}, size, WHITE);
-                    DrawModel(column, (Vector3){x * size, 0.2f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 8) {
-                    DrawModel(wallWolf, (Vector3){x * size, 0.0f, y * size}, size, WHITE);
-                } else if (cel.raw_value == 9) {
-                    //
-                } else {
-                    DrawModel(wall, (Vector3){x * size, 0.0f, y * size}, size, WHITE);
-                }
-            }
+        if (render_mode == RENDER_SOFTWARE) {
+            // drawn as a 2d image below
+        } else if (render_mode == RENDER_BAKED) {
+            bake_world_draw(&baked, &frustum, &cull_stats);
+        } else if (render_mode == RENDER_STREAMED) {
+            stream_draw(stream, &frustum, &cull_stats);
+        } else {
+            tiles_draw(&tiles, map_file, occluded ? &visibility : NULL);
         }
 
         // billboard
@@ -372,23 +822,52 @@ int main(void) {
                          (Vector2){0}, 0.0f, WHITE);
         EndMode3D();
 
+        if (render_mode == RENDER_SOFTWARE) {
+            DrawTexturePro(soft_frame, (Rectangle){0, 0, soft.width, soft.height},
+                           (Rectangle){0, 0, GetScreenWidth(), GetScreenHeight()}, (Vector2){0}, 0.0f, WHITE);
+        }
+
         // 2d draw
+        // the dialogue types and waves every frame, it is drawn directly
         if (IsKeyDown(KEY_SPACE) == 1) {
-            GuiGameDrawTextBox("Space pressed", (Vector2){ 30, 740} , fonts[1], BLANK, MAGENTA);
-            p += 4;
+            revealed += GetFrameTime() * TYPEWRITER_SPEED * TYPEWRITER_FAST;
         }else{
-            p += 1;
+            revealed += GetFrameTime() * TYPEWRITER_SPEED;
         }
+        GuiGameDrawSubTextBox(message.wrapped, (int)revealed, (Vector2){30, 30}, fonts[1], Fade(BROWN, 0.9f), WHITE);
 
-        GuiGameDrawSubTextBox(message, p, (Vector2){30, 30}, fonts[1], Fade(BROWN, 0.9f), WHITE);
-        if (GuiGameDrawButton("Click me!!", fonts[1], (Vector2) {470, 380}, GOLD, BLACK)) {
-            p = 0;
+        GuiGameLayerBegin(&hud);
+        if (IsKeyDown(KEY_SPACE) == 1) {
+            GuiGameLayerTextBox(&hud, "^^Space pressed^^", (Vector2){ 30, 740} , fonts[0], BLANK, MAGENTA);
+        }
+        if (GuiGameLayerButton(&hud, "Click me!!", fonts[1], (Vector2) {470, 380}, GOLD, BLACK)) {
+            revealed = 0.0f;
         }
-
-        GuiGameDrawTextBox(TextFormat("Mouse Pos: %i %i", GetMouseX(), GetMouseY()), (Vector2){ 30, 820} , fonts[1], WHITE, MAGENTA);
         // GuiGameSliderBar((Rectangle){ 30, 730, 80, 10 }, "0", "4.0", &sphere_r, 0.0, 4.0);
-
-        DebugCameraGame(&camera_game, (Vector2){30, 400});
+        GuiGameLayerEnd(&hud);
+
+        GuiGameLayerBegin(&debug);
+        DebugCameraGame(&debug, &camera_game, (Vector2){30, 400});
+        GuiGameLayerTextBox(&debug, TextFormat("Render: %s, tris %ld -> %ld", RENDER_MODE_NAMES[render_mode],
+                                               baked.stats.triangles_before, baked.stats.triangles_after),
+                            (Vector2){30, 520}, DEBUG_FONT, DARKGREEN, WHITE);
+        GuiGameLayerTextBox(&debug, TextFormat("Chunks: %d visible of %d tested", cull_stats.visible, cull_stats.tested),
+                            (Vector2){30, 560}, DEBUG_FONT, DARKGREEN, WHITE);
+        GuiGameLayerTextBox(&debug, TextFormat("Cels: %d visible of %d%s%s", occluded ? visibility.visible_count : grid_area(map_file),
+                                               grid_area(map_file), occlusion ? "" : " (occlusion off)",
+                                               occluded && visibility.pvs_set ? " (pvs)" : ""),
+                            (Vector2){30, 600}, DEBUG_FONT, DARKGREEN, WHITE);
+        GuiGameLayerEnd(&debug);
+
+        // counters change every frame, a layer would be redrawn every frame too
+        GuiGameDrawTextBox(TextFormat("Mouse Pos: %i %i", GetMouseX(), GetMouseY()), (Vector2){ 30, 820} , fonts[1], WHITE, MAGENTA);
+        GuiGameDrawTextBox(TextFormat("Layouts: %lu hits %lu misses, texts: %lu hits %lu misses, glyphs: %lu paged %lu evicted",
+                                      GuiGameLayoutCache.hits, GuiGameLayoutCache.misses,
+                                      EmotionalTextCache.hits, EmotionalTextCache.misses,
+                                      EmotionalTextAtlases.rasterized, EmotionalTextAtlases.evictions),
+                           (Vector2){30, 640}, DEBUG_FONT, DARKGREEN, WHITE);
+        GuiGameDrawTextBox(TextFormat("UI layers: hud %lu redraws, debug %lu", hud.redraws, debug.redraws),
+                           (Vector2){30, 680}, DEBUG_FONT, DARKGREEN, WHITE);
 
         DrawFPS(0, 0);
         if (camera_game.active_proj == CAMERA_PERSPECTIVE) {
@@ -403,9 +882,30 @@ int main(void) {
     }
 
     // shutdown
-    for (size_t i = 0; i < FONTS; i++) {
-        UnloadFont(fonts[i].font);
+    if (stream) {
+        stream_close(stream);
+    }
+    UnloadTexture(soft_frame);
+    soft_free(&soft);
+    bake_world_free(&baked);
+    visibility_free(&visibility);
+    tiles_free(&tiles);
+    grid_free(&map_file);
+    UnloadShader(tiles.shader);
+    if (BAKE_QUANTIZE) {
+        UnloadShader(baked_shader);
     }
+    GuiGameLayerFree(&hud);
+    GuiGameLayerFree(&debug);
+    UnloadEmotionalFlow(&message);
+    UnloadEmotionalTextCache();
+    GuiGameLayoutCacheFree();
+    UnloadShader(text_shader);
+    UnloadShader(text_sdf_shader);
+    UnloadFontGames(fonts, FONTS);
+    UnloadSound(click);
+    // after the tiles and the baked world, they borrow the materials
+    assets_free(assets);
     CloseWindow();
 
     return EXIT_SUCCESS;
@@ -0,0 +1,332 @@
+#include "softrender.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "raymath.h"
+
+#define TEXTURE_MASK (SOFT_TEXTURE_SIZE - 1)
+#define LANES 4
+#define SOFT_NEAR 0.01f // closest wall distance, in cels, a camera on a cel border hits at 0
+
+// four columns at a time, with the GCC vector extensions
+typedef float v4f __attribute__((vector_size(LANES * sizeof(float))));
+typedef int v4i __attribute__((vector_size(LANES * sizeof(int))));
+
+typedef struct {
+    SoftRenderer* soft;
+    Grid grid;
+    // in grid units, cel (row, col) covers [row, row + 1) x [col, col + 1)
+    float pos_x;
+    float pos_z;
+    float dir_x;
+    float dir_z;
+    float plane_x;
+    float plane_z;
+    float focal;
+    int first_col;
+    int last_col;
+} SoftBand;
+
+// Workers live as long as the renderer: each frame they wait for the bands on
+// start, draw theirs and meet the caller again on done.
+struct SoftPool {
+    pthread_t workers[SOFT_THREADS_MAX];
+    SoftBand bands[SOFT_THREADS_MAX];
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    bool quit;
+};
+
+typedef struct {
+    SoftPool* pool;
+    int index;
+} SoftWorker;
+
+static void soft_band_render(SoftBand* band);
+
+static void* soft_worker(void* arg) {
+    SoftWorker worker = *(SoftWorker*)arg;
+    free(arg);
+    for (;;) {
+        pthread_barrier_wait(&worker.pool->start);
+        if (worker.pool->quit) {
+            return NULL;
+        }
+        soft_band_render(&worker.pool->bands[worker.index]);
+        pthread_barrier_wait(&worker.pool->done);
+    }
+}
+
+static SoftPool* soft_pool_new(int threads) {
+    SoftPool* pool = (SoftPool*)calloc(1, sizeof(SoftPool));
+    pthread_barrier_init(&pool->start, NULL, threads);
+    pthread_barrier_init(&pool->done, NULL, threads);
+    for (int i = 1; i < threads; i++) {
+        SoftWorker* worker = (SoftWorker*)malloc(sizeof(SoftWorker));
+        *worker            = (SoftWorker){pool, i};
+        if (pthread_create(&pool->workers[i], NULL, soft_worker, worker) != 0) {
+            printf("[ERROR] Could not start a raycaster thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+static void soft_pool_free(SoftPool* pool, int threads) {
+    pool->quit = true;
+    pthread_barrier_wait(&pool->start);
+    for (int i = 1; i < threads; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->done);
+    free(pool);
+}
+
+SoftRenderer soft_new(int width, int height) {
+    SoftRenderer soft = {0};
+    soft.width        = width;
+    soft.height       = height;
+    soft.pixels       = (Color*)calloc(width * height, sizeof(Color));
+    soft.ceiling      = (Color){40, 40, 48, 255};
+
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    soft.threads = threads < 1 ? 1 : (threads > SOFT_THREADS_MAX ? SOFT_THREADS_MAX : threads);
+    soft.pool    = soft.threads > 1 ? soft_pool_new(soft.threads) : NULL;
+    return soft;
+}
+
+static Color* soft_texture(Image image, bool by_column) {
+    Image copy = ImageCopy(image);
+    ImageFormat(&copy, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageResizeNN(&copy, SOFT_TEXTURE_SIZE, SOFT_TEXTURE_SIZE);
+
+    Color* texels = (Color*)malloc(SOFT_TEXTURE_SIZE * SOFT_TEXTURE_SIZE * sizeof(Color));
+    Color* data   = (Color*)copy.data;
+    for (int y = 0; y < SOFT_TEXTURE_SIZE; y++) {
+        for (int x = 0; x < SOFT_TEXTURE_SIZE; x++) {
+            int index     = by_column ? x * SOFT_TEXTURE_SIZE + y : y * SOFT_TEXTURE_SIZE + x;
+            texels[index] = data[y * SOFT_TEXTURE_SIZE + x];
+        }
+    }
+    UnloadImage(copy);
+    return texels;
+}
+
+void soft_set_wall(SoftRenderer* soft, int raw_value, Image image) {
+    if ((raw_value < 0) || (raw_value >= TILE_TYPES)) {
+        printf("[ERROR] Tile type out of range: %d\n", raw_value);
+        exit(EXIT_FAILURE);
+    }
+    free(soft->walls[raw_value]);
+    soft->walls[raw_value] = soft_texture(image, true);
+}
+
+// floor, no wall
+void soft_set_empty(SoftRenderer* soft, int raw_value) {
+    if ((raw_value < 0) || (raw_value >= TILE_TYPES)) {
+        printf("[ERROR] Tile type out of range: %d\n", raw_value);
+        exit(EXIT_FAILURE);
+    }
+    soft->empty[raw_value] = true;
+}
+
+// walls for the cels with neither a wall nor set empty
+void soft_set_wall_fallback(SoftRenderer* soft, Image image) {
+    free(soft->wall_fallback);
+    soft->wall_fallback = soft_texture(image, true);
+}
+
+void soft_set_floor(SoftRenderer* soft, Image image) {
+    free(soft->floor);
+    soft->floor = soft_texture(image, false);
+}
+
+static const Color* soft_wall(SoftRenderer* soft, int raw_value) {
+    if ((raw_value < 0) || (raw_value >= TILE_TYPES)) {
+        return soft->wall_fallback;
+    }
+    if (soft->empty[raw_value]) {
+        return NULL;
+    }
+    return soft->walls[raw_value] ? soft->walls[raw_value] : soft->wall_fallback;
+}
+
+static Color shade(Color color) {
+    return (Color){color.r / 2, color.g / 2, color.b / 2, color.a};
+}
+
+// Floor below the horizon and flat ceiling above it, for the band columns.
+// Every row is a straight line on the floor, so its texture coordinates step
+// evenly along the columns and are computed LANES columns at a time.
+static void soft_band_floor(SoftBand* band) {
+    SoftRenderer* soft    = band->soft;
+    int           horizon = soft->height / 2;
+    for (int y = 0; y < horizon; y++) {
+        Color* row = soft->pixels + y * soft->width;
+        for (int x = band->first_col; x < band->last_col; x++) {
+            row[x] = soft->ceiling;
+        }
+    }
+    if (!soft->floor) {
+        return;
+    }
+
+    v4f lane = {0.0f, 1.0f, 2.0f, 3.0f};
+    for (int y = horizon; y < soft->height; y++) {
+        // eye at half a cel over the floor
+        float  distance = 0.5f * band->focal / (y - horizon + 0.5f);
+        Color* row      = soft->pixels + y * soft->width;
+
+        int x = band->first_col;
+        for (; x + LANES <= band->last_col; x += LANES) {
+            v4f camera  = (2.0f * (lane + (float)x)) / (float)soft->width - 1.0f;
+            v4f world_x = band->pos_x + (band->dir_x + band->plane_x * camera) * distance;
+            v4f world_z = band->pos_z + (band->dir_z + band->plane_z * camera) * distance;
+            v4i tex_x   = __builtin_convertvector(world_x * (float)SOFT_TEXTURE_SIZE, v4i) & TEXTURE_MASK;
+            v4i tex_z   = __builtin_convertvector(world_z * (float)SOFT_TEXTURE_SIZE, v4i) & TEXTURE_MASK;
+            v4i texel   = tex_z * SOFT_TEXTURE_SIZE + tex_x;
+            for (int i = 0; i < LANES; i++) {
+                row[x + i] = soft->floor[texel[i]];
+            }
+        }
+        for (; x < band->last_col; x++) {
+            float camera  = 2.0f * x / soft->width - 1.0f;
+            float world_x = band->pos_x + (band->dir_x + band->plane_x * camera) * distance;
+            float world_z = band->pos_z + (band->dir_z + band->plane_z * camera) * distance;
+            int   tex_x   = (int)(world_x * SOFT_TEXTURE_SIZE) & TEXTURE_MASK;
+            int   tex_z   = (int)(world_z * SOFT_TEXTURE_SIZE) & TEXTURE_MASK;
+            row[x]        = soft->floor[tex_z * SOFT_TEXTURE_SIZE + tex_x];
+        }
+    }
+}
+
+// One ray per column through the grid (DDA), the first wall hit is drawn as
+// a vertical textured slice over the floor.
+static void soft_band_walls(SoftBand* band) {
+    SoftRenderer* soft = band->soft;
+    Grid          grid = band->grid;
+    for (int x = band->first_col; x < band->last_col; x++) {
+        float camera = 2.0f * x / soft->width - 1.0f;
+        float dir_x  = band->dir_x + band->plane_x * camera;
+        float dir_z  = band->dir_z + band->plane_z * camera;
+
+        int   row       = (int)floorf(band->pos_x);
+        int   col       = (int)floorf(band->pos_z);
+        int   step_row  = dir_x < 0.0f ? -1 : 1;
+        int   step_col  = dir_z < 0.0f ? -1 : 1;
+        float delta_row = dir_x != 0.0f ? fabsf(1.0f / dir_x) : INFINITY;
+        float delta_col = dir_z != 0.0f ? fabsf(1.0f / dir_z) : INFINITY;
+        float side_row  = (dir_x < 0.0f ? band->pos_x - row : row + 1.0f - band->pos_x) * delta_row;
+        float side_col  = (dir_z < 0.0f ? band->pos_z - col : col + 1.0f - band->pos_z) * delta_col;
+
+        const Color* wall = NULL;
+        bool         side = false;
+        while (!wall) {
+            if (side_row < side_col) {
+                side_row += delta_row;
+                row += step_row;
+                side = false;
+            } else {
+                side_col += delta_col;
+                col += step_col;
+                side = true;
+            }
+            if (!grid_index_valid(grid, row, col)) {
+                break;
+            }
+            wall = soft_wall(soft, grid_at(grid, row, col)->raw_value);
+        }
+        if (!wall) {
+            continue;
+        }
+
+        float distance = fmaxf(side ? side_col - delta_col : side_row - delta_row, SOFT_NEAR);
+        float hit      = side ? band->pos_x + distance * dir_x : band->pos_z + distance * dir_z;
+        int   tex_x    = (int)((hit - floorf(hit)) * SOFT_TEXTURE_SIZE) & TEXTURE_MASK;
+        if ((!side && dir_x > 0.0f) || (side && dir_z < 0.0f)) {
+            tex_x = TEXTURE_MASK - tex_x;
+        }
+
+        int   height = (int)(band->focal / distance);
+        int   start  = soft->height / 2 - height / 2;
+        int   end    = start + height;
+        float step   = (float)SOFT_TEXTURE_SIZE / height;
+        float tex_y  = 0.0f;
+        if (start < 0) {
+            tex_y = -start * step;
+            start = 0;
+        }
+        end = end > soft->height ? soft->height : end;
+
+        const Color* column = wall + tex_x * SOFT_TEXTURE_SIZE;
+        for (int y = start; y < end; y++, tex_y += step) {
+            Color texel                       = column[(int)tex_y & TEXTURE_MASK];
+            soft->pixels[y * soft->width + x] = side ? shade(texel) : texel;
+        }
+    }
+}
+
+static void soft_band_render(SoftBand* band) {
+    soft_band_floor(band);
+    soft_band_walls(band);
+}
+
+// The screen is split in vertical bands, one per thread, which share nothing
+// but the read only grid and textures. The calling thread draws the first.
+void soft_render(SoftRenderer* soft, Grid grid, Camera3D camera) {
+    Vector3 forward = Vector3Subtract(camera.target, camera.position);
+    Vector2 dir     = Vector2Normalize((Vector2){forward.x, forward.z});
+    float   aspect  = (float)soft->width / soft->height;
+    float   half_h  = tanf(camera.fovy * DEG2RAD / 2.0f);
+
+    SoftBand base = {0};
+    base.soft     = soft;
+    base.grid     = grid;
+    base.pos_x    = camera.position.x / TILE_SIZE + 0.5f;
+    base.pos_z    = camera.position.z / TILE_SIZE + 0.5f;
+    base.dir_x    = dir.x;
+    base.dir_z    = dir.y;
+    // screen right is forward x up
+    base.plane_x = -dir.y * half_h * aspect;
+    base.plane_z = dir.x * half_h * aspect;
+    base.focal   = (soft->height / 2.0f) / half_h;
+
+    if (!soft->pool) {
+        base.first_col = 0;
+        base.last_col  = soft->width;
+        soft_band_render(&base);
+        return;
+    }
+
+    SoftBand* bands = soft->pool->bands;
+    int       width = (soft->width + soft->threads - 1) / soft->threads;
+    for (int i = 0; i < soft->threads; i++) {
+        bands[i]           = base;
+        bands[i].first_col = i * width < soft->width ? i * width : soft->width;
+        bands[i].last_col  = (i + 1) * width < soft->width ? (i + 1) * width : soft->width;
+    }
+    pthread_barrier_wait(&soft->pool->start);
+    soft_band_render(&bands[0]);
+    pthread_barrier_wait(&soft->pool->done);
+}
+
+// the framebuffer as an image, not a copy
+Image soft_image(SoftRenderer* soft) {
+    return (Image){soft->pixels, soft->width, soft->height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+}
+
+void soft_free(SoftRenderer* soft) {
+    if (soft->pool) {
+        soft_pool_free(soft->pool, soft->threads);
+    }
+    for (int i = 0; i < TILE_TYPES; i++) {
+        free(soft->walls[i]);
+    }
+    free(soft->wall_fallback);
+    free(soft->floor);
+    free(soft->pixels);
+    *soft = (SoftRenderer){0};
+}
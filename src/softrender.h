@@ -0,0 +1,39 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "map.h"
+#include "tiles.h"
+
+#define SOFT_TEXTURE_SIZE 64
+#define SOFT_THREADS_MAX 16
+
+typedef struct SoftRenderer SoftRenderer;
+typedef struct SoftPool SoftPool;
+
+// Wolfenstein style raycaster drawing the grid into a CPU framebuffer, no GPU
+// needed. Cels with a wall texture are walls one cel tall, empty cels are
+// floor and the others use the fallback wall, like tiles_def. Textures are
+// resized to SOFT_TEXTURE_SIZE and walls are kept column by column, the order
+// they are read in.
+struct SoftRenderer {
+    int width;
+    int height;
+    Color* pixels;
+    Color* walls[TILE_TYPES];
+    bool empty[TILE_TYPES];
+    Color* wall_fallback;
+    Color* floor;
+    Color ceiling;
+    int threads;
+    SoftPool* pool; // the workers drawing all the bands but the first
+};
+
+SoftRenderer soft_new(int width, int height);
+void soft_set_wall(SoftRenderer* soft, int raw_value, Image image);
+void soft_set_empty(SoftRenderer* soft, int raw_value);
+void soft_set_wall_fallback(SoftRenderer* soft, Image image);
+void soft_set_floor(SoftRenderer* soft, Image image);
+void soft_render(SoftRenderer* soft, Grid grid, Camera3D camera);
+Image soft_image(SoftRenderer* soft);
+void soft_free(SoftRenderer* soft);
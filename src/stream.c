@@ -0,0 +1,201 @@
+#include "stream.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STREAM_IDLE_US 2000
+
+// in chunks, along the furthest axis
+static long chunk_distance(long row, long col, long center_row, long center_col) {
+    long d_row = labs(row - center_row);
+    long d_col = labs(col - center_col);
+    return d_row > d_col ? d_row : d_col;
+}
+
+static StreamChunk* stream_read_chunk(Stream* stream, size_t row, size_t col) {
+    size_t chunk_size = stream->header.chunk_size;
+    size_t index      = row * stream->chunk_cols + col;
+    size_t bytes      = chunk_size * chunk_size * sizeof(Cel);
+
+    Grid cels = grid_new(chunk_size, chunk_size);
+    if (pread(stream->fd, cels.cels, bytes, stream->header.cels_offset + index * bytes) != (ssize_t)bytes) {
+        printf("[ERROR] Could not read chunk %zu %zu: %s\n", row, col, stream->path);
+        exit(EXIT_FAILURE);
+    }
+
+    // the padding past the map border is not part of the world
+    size_t rows = stream->header.rows - row * chunk_size;
+    size_t cols = stream->header.cols - col * chunk_size;
+    grid_update_size(&cels, rows < chunk_size ? rows : chunk_size, cols < chunk_size ? cols : chunk_size);
+
+    StreamChunk* chunk = (StreamChunk*)calloc(1, sizeof(StreamChunk));
+    chunk->row         = row;
+    chunk->col         = col;
+    chunk->baked       = bake_chunk_cels(cels, stream->tiles, row, col);
+    grid_free(&cels);
+    return chunk;
+}
+
+// Nearest chunk around the center that was not handed to the main thread yet.
+static bool stream_next_chunk(Stream* stream, long center_row, long center_col, size_t* row, size_t* col) {
+    for (long radius = 0; radius <= STREAM_RADIUS; radius++) {
+        for (long r = center_row - radius; r <= center_row + radius; r++) {
+            for (long c = center_col - radius; c <= center_col + radius; c++) {
+                if (chunk_distance(r, c, center_row, center_col) != radius) {
+                    continue;
+                }
+                if ((r < 0) || (c < 0) || (r >= (long)stream->chunk_rows) || (c >= (long)stream->chunk_cols)) {
+                    continue;
+                }
+                if (!stream->requested[r * stream->chunk_cols + c]) {
+                    *row = r;
+                    *col = c;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+static void* stream_loader(void* arg) {
+    Stream* stream = (Stream*)arg;
+    while (atomic_load(&stream->running)) {
+        StreamChunk* evicted;
+        while ((evicted = spsc_pop(&stream->evicted))) {
+            stream->requested[evicted->row * stream->chunk_cols + evicted->col] = false;
+            free(evicted);
+        }
+
+        size_t row, col;
+        long   center_row = atomic_load(&stream->center_row);
+        long   center_col = atomic_load(&stream->center_col);
+        if (!stream_next_chunk(stream, center_row, center_col, &row, &col)) {
+            usleep(STREAM_IDLE_US);
+            continue;
+        }
+
+        StreamChunk* chunk = stream_read_chunk(stream, row, col);
+        stream->requested[row * stream->chunk_cols + col] = true;
+        while (!spsc_push(&stream->ready, chunk)) {
+            if (!atomic_load(&stream->running)) {
+                // its meshes are freed on the main thread, UnloadMesh needs the GL context
+                stream->unsent = chunk;
+                return NULL;
+            }
+            usleep(STREAM_IDLE_US);
+        }
+    }
+    return NULL;
+}
+
+Stream* stream_open(char* path, TileRenderer* tiles) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("[ERROR] Cound not open the file map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    MapHeader   header = {0};
+    if ((fstat(fd, &st) != 0) || (pread(fd, &header, sizeof(header), 0) <= 0) ||
+        (memcmp(header.magic, MAP_BINARY_MAGIC, sizeof(header.magic)) != 0)) {
+        printf("[ERROR] Not a binary map: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    map_header_check(&header, st.st_size, path);
+    if (header.chunk_size != BAKE_CHUNK_SIZE) {
+        printf("[ERROR] Streamed maps need chunks of %d cels, got %u: %s\n", BAKE_CHUNK_SIZE, header.chunk_size, path);
+        exit(EXIT_FAILURE);
+    }
+
+    Stream* stream     = (Stream*)calloc(1, sizeof(Stream));
+    stream->path       = path;
+    stream->fd         = fd;
+    stream->header     = header;
+    stream->chunk_rows = map_header_chunk_rows(header);
+    stream->chunk_cols = map_header_chunk_cols(header);
+    stream->tiles      = tiles;
+    stream->requested  = (bool*)calloc(stream->chunk_rows * stream->chunk_cols, sizeof(bool));
+    spsc_init(&stream->ready);
+    spsc_init(&stream->evicted);
+    atomic_init(&stream->running, true);
+    atomic_init(&stream->center_row, 0);
+    atomic_init(&stream->center_col, 0);
+
+    if (pthread_create(&stream->thread, NULL, stream_loader, stream) != 0) {
+        printf("[ERROR] Could not start the map loader thread\n");
+        exit(EXIT_FAILURE);
+    }
+    return stream;
+}
+
+void stream_update(Stream* stream, Vector3 position) {
+    float chunk_world = TILE_SIZE * BAKE_CHUNK_SIZE;
+    long  center_row  = (long)floorf((position.x + TILE_SIZE / 2.0f) / chunk_world);
+    long  center_col  = (long)floorf((position.z + TILE_SIZE / 2.0f) / chunk_world);
+    atomic_store(&stream->center_row, center_row);
+    atomic_store(&stream->center_col, center_col);
+
+    // one chunk of slack, so moving back and forth over a border does not reload.
+    // Unloaded before the push, the loader frees the chunk as soon as it pops it.
+    // When the queue is full the chunk stays, unloaded, and is pushed again next frame.
+    for (int i = 0; i < stream->loaded_count;) {
+        StreamChunk* chunk = stream->loaded[i];
+        if (chunk->baked.uploaded &&
+            (chunk_distance(chunk->row, chunk->col, center_row, center_col) <= STREAM_RADIUS + 1)) {
+            i++;
+            continue;
+        }
+        bake_chunk_free(&chunk->baked);
+        if (!spsc_push(&stream->evicted, chunk)) {
+            i++;
+            continue;
+        }
+        stream->loaded[i] = stream->loaded[--stream->loaded_count];
+    }
+
+    for (int i = 0; (i < STREAM_UPLOADS_PER_FRAME) && (stream->loaded_count < STREAM_LOADED_MAX); i++) {
+        StreamChunk* chunk = spsc_pop(&stream->ready);
+        if (!chunk) {
+            break;
+        }
+        bake_chunk_upload(&chunk->baked);
+        stream->loaded[stream->loaded_count++] = chunk;
+    }
+}
+
+void stream_draw(Stream* stream, const Frustum* frustum, CullStats* stats) {
+    for (int i = 0; i < stream->loaded_count; i++) {
+        bake_chunk_draw(&stream->loaded[i]->baked, frustum, stats);
+    }
+}
+
+void stream_close(Stream* stream) {
+    atomic_store(&stream->running, false);
+    pthread_join(stream->thread, NULL);
+
+    StreamChunk* chunk;
+    while ((chunk = spsc_pop(&stream->ready))) {
+        bake_chunk_free(&chunk->baked);
+        free(chunk);
+    }
+    while ((chunk = spsc_pop(&stream->evicted))) {
+        free(chunk);
+    }
+    for (int i = 0; i < stream->loaded_count; i++) {
+        bake_chunk_free(&stream->loaded[i]->baked);
+        free(stream->loaded[i]);
+    }
+    if (stream->unsent) {
+        bake_chunk_free(&stream->unsent->baked);
+        free(stream->unsent);
+    }
+
+    close(stream->fd);
+    free(stream->requested);
+    free(stream);
+}
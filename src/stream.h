@@ -0,0 +1,55 @@
+#pragma once
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "bake.h"
+#include "map.h"
+#include "queue.h"
+#include "tiles.h"
+
+#define STREAM_RADIUS 2
+#define STREAM_LOADED_MAX 64
+#define STREAM_UPLOADS_PER_FRAME 4
+
+typedef struct StreamChunk StreamChunk;
+typedef struct Stream Stream;
+
+struct StreamChunk {
+    size_t row;
+    size_t col;
+    BakedChunk baked;
+};
+
+// Pages the chunks of a chunked binary map around the camera. A loader thread
+// reads and bakes the chunks, the main thread uploads them to the GPU, draws
+// and evicts them. Chunks travel between both through lock-free queues.
+struct Stream {
+    char* path;
+    int fd;
+    MapHeader header;
+    size_t chunk_rows;
+    size_t chunk_cols;
+    TileRenderer* tiles;
+
+    pthread_t thread;
+    atomic_bool running;
+    atomic_long center_row;
+    atomic_long center_col;
+    SpscQueue ready;   // loader -> main, baked chunks waiting for upload
+    SpscQueue evicted; // main -> loader, unloaded chunks to forget and free
+
+    // loader thread only
+    bool* requested;
+    StreamChunk* unsent; // baked when the loader stopped, freed by stream_close
+
+    // main thread only
+    StreamChunk* loaded[STREAM_LOADED_MAX];
+    int loaded_count;
+};
+
+Stream* stream_open(char* path, TileRenderer* tiles);
+void stream_update(Stream* stream, Vector3 position);
+void stream_draw(Stream* stream, const Frustum* frustum, CullStats* stats);
+void stream_close(Stream* stream);
@@ -0,0 +1,171 @@
+#include "tiles.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "raymath.h"
+#include "visibility.h"
+
+#define BATCH_INITIAL_CAPACITY 64
+
+TileRenderer tiles_new(Shader shader) {
+    TileRenderer tiles = {0};
+    // DrawMeshInstanced binds the per instance matrix to the model matrix location
+    shader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(shader, "instanceTransform");
+    tiles.shader = shader;
+    tiles.dirty  = true;
+    return tiles;
+}
+
+TileDef* tiles_def(TileRenderer* tiles, int raw_value) {
+    if ((raw_value >= 0) && (raw_value < TILE_TYPES) && tiles->defs[raw_value].defined) {
+        return &tiles->defs[raw_value];
+    }
+    return &tiles->fallback;
+}
+
+static uint32_t tiles_solid_bit(int raw_value) {
+    return (raw_value >= 0) && (raw_value < TILE_TYPES) ? 1u << raw_value : TILE_SOLID_OTHER;
+}
+
+void tiles_set_solid(TileRenderer* tiles, int raw_value) {
+    tiles->solid |= tiles_solid_bit(raw_value);
+}
+
+bool tiles_is_solid(const TileRenderer* tiles, int raw_value) {
+    return tiles->solid & tiles_solid_bit(raw_value);
+}
+
+static void tiledef_push(TileDef* def, TilePart part) {
+    if (def->parts_count >= TILE_PARTS_MAX) {
+        printf("[ERROR] Tile has too many parts, max: %d\n", TILE_PARTS_MAX);
+        exit(EXIT_FAILURE);
+    }
+    def->defined                   = true;
+    def->parts[def->parts_count++] = part;
+}
+
+void tiles_define(TileRenderer* tiles, int raw_value, TilePart part) {
+    if ((raw_value < 0) || (raw_value >= TILE_TYPES)) {
+        printf("[ERROR] Tile type out of range: %d\n", raw_value);
+        exit(EXIT_FAILURE);
+    }
+    tiledef_push(&tiles->defs[raw_value], part);
+    tiles->dirty = true;
+}
+
+void tiles_define_fallback(TileRenderer* tiles, TilePart part) {
+    tiledef_push(&tiles->fallback, part);
+    tiles->dirty = true;
+}
+
+void tiles_define_empty(TileRenderer* tiles, int raw_value) {
+    if ((raw_value < 0) || (raw_value >= TILE_TYPES)) {
+        printf("[ERROR] Tile type out of range: %d\n", raw_value);
+        exit(EXIT_FAILURE);
+    }
+    tiles->defs[raw_value].defined = true;
+    tiles->dirty                   = true;
+}
+
+void tiles_invalidate(TileRenderer* tiles) {
+    tiles->dirty = true;
+}
+
+static TileBatch* tiles_batch(TileRenderer* tiles, TilePart part) {
+    for (int i = 0; i < tiles->batches_count; i++) {
+        TileBatch* batch = &tiles->batches[i];
+        if ((batch->part.model == part.model) && (batch->part.offset_y == part.offset_y)) {
+            return batch;
+        }
+    }
+    if (tiles->batches_count >= TILE_BATCHES_MAX) {
+        printf("[ERROR] Too many tile batches, max: %d\n", TILE_BATCHES_MAX);
+        exit(EXIT_FAILURE);
+    }
+    TileBatch* batch = &tiles->batches[tiles->batches_count++];
+    batch->part      = part;
+    batch->count     = 0;
+    return batch;
+}
+
+static void batch_push(TileBatch* batch, Matrix transform) {
+    if (batch->count >= batch->capacity) {
+        batch->capacity   = batch->capacity ? batch->capacity * 2 : BATCH_INITIAL_CAPACITY;
+        batch->transforms = (Matrix*)realloc(batch->transforms, batch->capacity * sizeof(Matrix));
+    }
+    batch->transforms[batch->count++] = transform;
+}
+
+Matrix tiles_part_transform(TilePart part, size_t row, size_t col) {
+    Matrix scale     = MatrixScale(TILE_SIZE, TILE_SIZE, TILE_SIZE);
+    Matrix translate = MatrixTranslate(row * TILE_SIZE, part.offset_y, col * TILE_SIZE);
+    return MatrixMultiply(part.model->transform, MatrixMultiply(scale, translate));
+}
+
+// With a visibility only its visible cels are kept.
+void tiles_build(TileRenderer* tiles, Grid grid, const Visibility* visibility) {
+    // keep the allocations around, only the counts are reset
+    for (int i = 0; i < tiles->batches_count; i++) {
+        tiles->batches[i].count = 0;
+    }
+
+    for (size_t x = 0; x < grid.rows; x++) {
+        for (size_t y = 0; y < grid.cols; y++) {
+            if (visibility && !visibility_cel_visible(visibility, x, y)) {
+                continue;
+            }
+            TileDef* def = tiles_def(tiles, grid_at(grid, x, y)->raw_value);
+            for (int p = 0; p < def->parts_count; p++) {
+                TilePart part = def->parts[p];
+                batch_push(tiles_batch(tiles, part), tiles_part_transform(part, x, y));
+            }
+        }
+    }
+    tiles->dirty            = false;
+    tiles->built_visibility = visibility;
+    tiles->built_generation = visibility ? visibility->generation : 0;
+    tiles->built_pvs_set    = visibility ? visibility->pvs_set : NULL;
+}
+
+// A filtered build holds until the visible set changes: another generation of
+// cast cels, or another baked set.
+static bool tiles_stale(const TileRenderer* tiles, const Visibility* visibility) {
+    if (tiles->dirty || (tiles->built_visibility != visibility)) {
+        return true;
+    }
+    if (!visibility) {
+        return false;
+    }
+    if (visibility->pvs_set || tiles->built_pvs_set) {
+        return visibility->pvs_set != tiles->built_pvs_set;
+    }
+    return visibility->generation != tiles->built_generation;
+}
+
+void tiles_draw(TileRenderer* tiles, Grid grid, const Visibility* visibility) {
+    if (tiles_stale(tiles, visibility)) {
+        tiles_build(tiles, grid, visibility);
+    }
+
+    for (int i = 0; i < tiles->batches_count; i++) {
+        TileBatch* batch = &tiles->batches[i];
+        if (batch->count == 0) {
+            continue;
+        }
+        Model* model = batch->part.model;
+        for (int m = 0; m < model->meshCount; m++) {
+            Material material = model->materials[model->meshMaterial[m]];
+            material.shader   = tiles->shader;
+            DrawMeshInstanced(model->meshes[m], material, batch->transforms, batch->count);
+        }
+    }
+}
+
+void tiles_free(TileRenderer* tiles) {
+    for (int i = 0; i < tiles->batches_count; i++) {
+        free(tiles->batches[i].transforms);
+        tiles->batches[i] = (TileBatch){0};
+    }
+    tiles->batches_count = 0;
+    tiles->dirty         = true;
+}
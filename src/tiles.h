@@ -0,0 +1,68 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "map.h"
+
+#define TILE_SIZE 4
+#define TILE_TYPES 16
+#define TILE_PARTS_MAX 2
+#define TILE_BATCHES_MAX 32
+#define TILE_SOLID_OTHER (1u << TILE_TYPES)
+
+typedef struct TilePart TilePart;
+typedef struct TileDef TileDef;
+typedef struct TileBatch TileBatch;
+typedef struct TileRenderer TileRenderer;
+typedef struct Visibility Visibility;
+
+// One model placed inside a cell, lifted by offset_y.
+struct TilePart {
+    Model* model;
+    float offset_y;
+};
+
+struct TileDef {
+    bool defined;
+    TilePart parts[TILE_PARTS_MAX];
+    int parts_count;
+};
+
+// All the cells sharing the same part, drawn with a single DrawMeshInstanced per mesh.
+struct TileBatch {
+    TilePart part;
+    Matrix* transforms;
+    int count;
+    int capacity;
+};
+
+struct TileRenderer {
+    TileDef defs[TILE_TYPES];
+    TileDef fallback;
+    TileBatch batches[TILE_BATCHES_MAX];
+    int batches_count;
+    Shader shader;
+    // A solid tile fills the whole cell, hiding the faces of its neighbours
+    // that touch it and blocking sight. Bit per tile type, TILE_SOLID_OTHER for
+    // the values out of range. Saved with the visibility set it was baked with.
+    uint32_t solid;
+    bool dirty;
+    // what the batches were last built from, NULL for every cel
+    const Visibility* built_visibility;
+    uint32_t built_generation;
+    const uint8_t* built_pvs_set;
+};
+
+TileRenderer tiles_new(Shader shader);
+void tiles_define(TileRenderer* tiles, int raw_value, TilePart part);
+void tiles_define_fallback(TileRenderer* tiles, TilePart part);
+void tiles_define_empty(TileRenderer* tiles, int raw_value);
+TileDef* tiles_def(TileRenderer* tiles, int raw_value);
+void tiles_set_solid(TileRenderer* tiles, int raw_value);
+bool tiles_is_solid(const TileRenderer* tiles, int raw_value);
+Matrix tiles_part_transform(TilePart part, size_t row, size_t col);
+void tiles_invalidate(TileRenderer* tiles);
+void tiles_build(TileRenderer* tiles, Grid grid, const Visibility* visibility);
+void tiles_draw(TileRenderer* tiles, Grid grid, const Visibility* visibility);
+void tiles_free(TileRenderer* tiles);
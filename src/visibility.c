@@ -0,0 +1,139 @@
+#include "visibility.h"
+#include <math.h>
+#include "raymath.h"
+
+Visibility visibility_new(Grid grid) {
+    Visibility visibility = {0};
+    visibility.stamps     = (uint32_t*)calloc(grid.rows * grid.cols, sizeof(uint32_t));
+    visibility.rows       = grid.rows;
+    visibility.cols       = grid.cols;
+    return visibility;
+}
+
+void visibility_free(Visibility* visibility) {
+    free(visibility->stamps);
+    *visibility = (Visibility){0};
+}
+
+static void visibility_mark(Visibility* visibility, size_t row, size_t col) {
+    uint32_t* stamp = &visibility->stamps[row * visibility->cols + col];
+    if (*stamp != visibility->frame) {
+        visibility->visible_count++;
+        visibility->kept += *stamp == visibility->frame - 1;
+        *stamp = visibility->frame;
+    }
+}
+
+// Walks the cels crossed by the ray (Amanatides & Woo), marking them until a
+// solid one, which is marked too since its near faces are seen.
+static void visibility_ray(Visibility* visibility, Grid grid, TileRenderer* tiles, float x, float z, float dir_x,
+                           float dir_z) {
+    int   row        = (int)floorf(x);
+    int   col        = (int)floorf(z);
+    int   step_row   = dir_x < 0.0f ? -1 : 1;
+    int   step_col   = dir_z < 0.0f ? -1 : 1;
+    float delta_row  = dir_x != 0.0f ? fabsf(1.0f / dir_x) : INFINITY;
+    float delta_col  = dir_z != 0.0f ? fabsf(1.0f / dir_z) : INFINITY;
+    float side_row   = (dir_x < 0.0f ? x - row : row + 1.0f - x) * delta_row;
+    float side_col   = (dir_z < 0.0f ? z - col : col + 1.0f - z) * delta_col;
+    bool  first_cell = true;
+
+    while (grid_index_valid(grid, row, col)) {
+        visibility_mark(visibility, row, col);
+        if (!first_cell && tiles_is_solid(tiles, grid_at(grid, row, col)->raw_value)) {
+            return;
+        }
+        first_cell = false;
+
+        if (side_row < side_col) {
+            side_row += delta_row;
+            row += step_row;
+        } else {
+            side_col += delta_col;
+            col += step_col;
+        }
+    }
+}
+
+// Starts a new set of visible cels, the casts that follow add to it.
+void visibility_begin(Visibility* visibility) {
+    // a baked set is never the same as a cast one
+    visibility->previous_count = visibility->pvs_set ? -1 : visibility->visible_count;
+    visibility->frame++;
+    visibility->visible_count = 0;
+    visibility->kept          = 0;
+    visibility->pvs_set       = NULL;
+}
+
+// The set is the same as the previous one when it has as many cels and all of
+// them were seen again.
+static void visibility_end(Visibility* visibility) {
+    if ((visibility->visible_count != visibility->previous_count) ||
+        (visibility->kept != visibility->previous_count)) {
+        visibility->generation++;
+    }
+}
+
+// Casts rays all around the point (x, z), in grid units.
+void visibility_cast_around(Visibility* visibility, Grid grid, TileRenderer* tiles, float x, float z, int rays) {
+    for (int i = 0; i < rays; i++) {
+        float angle = (2.0f * PI * i) / rays;
+        visibility_ray(visibility, grid, tiles, x, z, cosf(angle), sinf(angle));
+    }
+}
+
+// Casts VISIBILITY_RAYS rays over the horizontal field of view, on the grid
+// plane. Only meaningful with the camera inside the map below the wall tops:
+// false is returned otherwise and everything should be drawn.
+bool visibility_cast(Visibility* visibility, Grid grid, TileRenderer* tiles, Camera3D camera, float aspect) {
+    if ((camera.projection != CAMERA_PERSPECTIVE) || (camera.position.y > TILE_SIZE)) {
+        return false;
+    }
+
+    // cel (row, col) covers [row, row + 1) x [col, col + 1) in grid units
+    float x = camera.position.x / TILE_SIZE + 0.5f;
+    float z = camera.position.z / TILE_SIZE + 0.5f;
+    if (!grid_index_valid(grid, (int)floorf(x), (int)floorf(z))) {
+        return false;
+    }
+
+    visibility_begin(visibility);
+
+    Vector3 forward  = Vector3Subtract(camera.target, camera.position);
+    float   yaw      = atan2f(forward.z, forward.x);
+    float   half_fov = atanf(tanf(camera.fovy * DEG2RAD / 2.0f) * aspect);
+    for (int i = 0; i < VISIBILITY_RAYS; i++) {
+        float angle = yaw - half_fov + (2.0f * half_fov * i) / (VISIBILITY_RAYS - 1);
+        visibility_ray(visibility, grid, tiles, x, z, cosf(angle), sinf(angle));
+    }
+    visibility_end(visibility);
+    return true;
+}
+
+// Picks the set baked for the camera cel, no rays are cast. Same limits as
+// visibility_cast, and solid cels have no set.
+bool visibility_use_pvs(Visibility* visibility, Grid grid, Camera3D camera) {
+    if (!grid.pvs || (camera.projection != CAMERA_PERSPECTIVE) || (camera.position.y > TILE_SIZE)) {
+        return false;
+    }
+    int row = (int)floorf(camera.position.x / TILE_SIZE + 0.5f);
+    int col = (int)floorf(camera.position.z / TILE_SIZE + 0.5f);
+    if (!grid_index_valid(grid, row, col)) {
+        return false;
+    }
+
+    const uint8_t* set = grid.pvs + (row * grid.cols + col) * grid.pvs_stride;
+    if (set == visibility->pvs_set) {
+        return true;
+    }
+    int count = 0;
+    for (size_t i = 0; i < grid.pvs_stride; i++) {
+        count += __builtin_popcount(set[i]);
+    }
+    if (count == 0) {
+        return false;
+    }
+    visibility->pvs_set       = set;
+    visibility->visible_count = count;
+    return true;
+}
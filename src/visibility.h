@@ -0,0 +1,42 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "map.h"
+#include "tiles.h"
+
+#define VISIBILITY_RAYS 480
+
+typedef struct Visibility Visibility;
+
+// Cels seen from the camera in the last visibility_cast. A cel is visible when
+// its stamp matches the current frame, so nothing is cleared between casts.
+// After visibility_use_pvs the baked set of the camera cel is used instead.
+// generation only changes when a cast sees other cels than the one before.
+struct Visibility {
+    uint32_t* stamps;
+    size_t rows;
+    size_t cols;
+    uint32_t frame;
+    int visible_count;
+    int previous_count;
+    int kept; // cels of the previous cast seen again
+    uint32_t generation;
+    const uint8_t* pvs_set;
+};
+
+Visibility visibility_new(Grid grid);
+void visibility_begin(Visibility* visibility);
+void visibility_cast_around(Visibility* visibility, Grid grid, TileRenderer* tiles, float x, float z, int rays);
+bool visibility_cast(Visibility* visibility, Grid grid, TileRenderer* tiles, Camera3D camera, float aspect);
+bool visibility_use_pvs(Visibility* visibility, Grid grid, Camera3D camera);
+void visibility_free(Visibility* visibility);
+
+static inline bool visibility_cel_visible(const Visibility* visibility, size_t row, size_t col) {
+    size_t index = row * visibility->cols + col;
+    if (visibility->pvs_set) {
+        return (visibility->pvs_set[index / 8] >> (index % 8)) & 1;
+    }
+    return visibility->stamps[index] == visibility->frame;
+}
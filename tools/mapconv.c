@@ -0,0 +1,63 @@
+// Convert a text map into the binary map format.
+//   mapconv src/map_01 src/map_01.bin
+//   mapconv -c 16 src/map_01 src/map_01.bin   (chunked, for streaming)
+//   mapconv -p 5,7,8 src/map_01 src/map_01.bin (with the visibility set, 5 7 and 8 being solid,
+//                                              saved in the map for the game to use the same ones)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/map.h"
+#include "../src/pvs.h"
+#include "../src/tiles.h"
+
+static void usage(const char* name) {
+    printf("usage: %s [-c chunk size] [-p solid values] <text map> <binary map>\n", name);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    size_t chunk_size = 0;
+    char*  solids     = NULL;
+    int    arg        = 1;
+    while ((argc > arg + 1) && (argv[arg][0] == '-')) {
+        if (strcmp(argv[arg], "-c") == 0) {
+            chunk_size = strtoul(argv[arg + 1], NULL, 10);
+        } else if (strcmp(argv[arg], "-p") == 0) {
+            solids = argv[arg + 1];
+        } else {
+            usage(argv[0]);
+        }
+        arg += 2;
+    }
+    if (argc - arg != 2) {
+        usage(argv[0]);
+    }
+    char* input  = argv[arg];
+    char* output = argv[arg + 1];
+
+    Grid grid = grid_load(input);
+    if (solids) {
+        TileRenderer tiles = {0};
+        for (char* value = strtok(solids, ","); value; value = strtok(NULL, ",")) {
+            tiles_set_solid(&tiles, atoi(value));
+        }
+        pvs_build(&grid, &tiles);
+        printf("[INFO] Visibility set: %zu bytes\n", grid.rows * grid.cols * grid.pvs_stride);
+    }
+    grid_save_binary_chunked(grid, output, chunk_size);
+
+    Grid saved = grid_load(output);
+    bool same_pvs = !grid.pvs || (saved.pvs && (saved.pvs_solid == grid.pvs_solid) &&
+                                  !memcmp(saved.pvs, grid.pvs, grid.rows * grid.cols * grid.pvs_stride));
+    if ((saved.rows != grid.rows) || (saved.cols != grid.cols) || (grid_checksum(saved) != grid_checksum(grid)) ||
+        !same_pvs) {
+        printf("[ERROR] Binary map does not match its source: %s\n", output);
+        return EXIT_FAILURE;
+    }
+    printf("[INFO] %s: %zux%zu cels, chunk size %zu, checksum %08x\n", output, grid.rows, grid.cols, chunk_size,
+           grid_checksum(grid));
+
+    grid_free(&saved);
+    grid_free(&grid);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+// Cook OBJ models into the binary mesh cache read by mesh_cache_load.
+//   meshcook models/medieval01/*.obj
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/mesh_cache.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s <obj>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int          cooked = 0;
+    MeshOptStats total  = {0};
+    for (int arg = 1; arg < argc; arg++) {
+        MeshCacheModel model = {0};
+        if (mesh_cache_read(argv[arg], &model)) {
+            mesh_cache_model_free(&model);
+            continue;
+        }
+        if (!mesh_cache_parse(argv[arg], &model)) {
+            printf("[ERROR] Could not read the model: %s\n", argv[arg]);
+            return EXIT_FAILURE;
+        }
+        if (!mesh_cache_write(argv[arg], model)) {
+            printf("[ERROR] Could not write the mesh cache of: %s\n", argv[arg]);
+            return EXIT_FAILURE;
+        }
+        mesh_opt_stats_add(&total, model.stats);
+        mesh_cache_model_free(&model);
+        cooked++;
+    }
+    // ACMR of the triangle soup, welded in the OBJ order, then ordered
+    float triangles = total.triangles > 0 ? (float)total.triangles : 1.0f;
+    printf("[INFO] Mesh cache: %d models, %d cooked, vertices %ld -> %ld, ACMR %.2f -> %.2f -> %.2f\n", argc - 1, cooked,
+           total.vertices_before, total.vertices_after, total.misses_before / triangles,
+           total.misses_welded / triangles, total.misses_after / triangles);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+// Headless software render of a map, for benchmarks and golden images.
+//   raycast src/map_01 build/raycast.png
+//   raycast src/map_01 build/raycast.png tools/golden/raycast_map_01.png (fails when they differ)
+// The camera and resolution are fixed so the output is the same on every run.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../src/map.h"
+#include "../src/softrender.h"
+
+#define WIDTH 640
+#define HEIGHT 360
+#define FRAMES 100
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void set_wall(SoftRenderer* soft, int raw_value, const char* path) {
+    Image image = LoadImage(path);
+    soft_set_wall(soft, raw_value, image);
+    UnloadImage(image);
+}
+
+// pixels differing from the golden image, all of them when the sizes differ
+static long golden_diff(Image frame, const char* path) {
+    Image golden = LoadImage(path);
+    if (!golden.data) {
+        printf("[ERROR] Could not load the golden image: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    ImageFormat(&golden, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    long pixels = (long)frame.width * frame.height;
+    long diff   = pixels;
+    if ((golden.width == frame.width) && (golden.height == frame.height)) {
+        diff = 0;
+        for (long i = 0; i < pixels; i++) {
+            diff += memcmp((Color*)golden.data + i, (Color*)frame.data + i, sizeof(Color)) != 0;
+        }
+    }
+    UnloadImage(golden);
+    return diff;
+}
+
+int main(int argc, char** argv) {
+    if ((argc != 3) && (argc != 4)) {
+        printf("usage: %s <map> <output png> [golden png]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    Grid         grid = grid_load(argv[1]);
+    SoftRenderer soft = soft_new(WIDTH, HEIGHT);
+    set_wall(&soft, 2, "models/medieval01/Textures/stones.png");
+    set_wall(&soft, 3, "models/medieval01/Textures/stones.png");
+    set_wall(&soft, 4, "models/medieval01/Textures/stonesPainted.png");
+    set_wall(&soft, 5, "textures/doom.png");
+    set_wall(&soft, 8, "textures/wolf.png");
+    soft_set_empty(&soft, 0);
+    soft_set_empty(&soft, 1);
+    soft_set_empty(&soft, 6);
+    soft_set_empty(&soft, 9);
+    Image fallback = LoadImage("textures/wall.png");
+    soft_set_wall_fallback(&soft, fallback);
+    UnloadImage(fallback);
+    Image floor = LoadImage("models/medieval01/Textures/planks.png");
+    soft_set_floor(&soft, floor);
+    UnloadImage(floor);
+
+    Camera3D camera   = {0};
+    camera.position   = (Vector3){36.0f, 2.0f, 20.0f};
+    camera.target     = (Vector3){46.0f, 2.0f, 30.0f};
+    camera.up         = (Vector3){0.0f, 1.0f, 0.0f};
+    camera.fovy       = 60.0f;
+    camera.projection = CAMERA_PERSPECTIVE;
+
+    double start = now_seconds();
+    for (int i = 0; i < FRAMES; i++) {
+        soft_render(&soft, grid, camera);
+    }
+    double frame = (now_seconds() - start) / FRAMES;
+    printf("raycast %dx%d on %d threads: %.3f ms/frame, %.1f Mpixels/s\n", WIDTH, HEIGHT, soft.threads, frame * 1e3,
+           WIDTH * HEIGHT / frame / 1e6);
+
+    if (!ExportImage(soft_image(&soft), argv[2])) {
+        printf("[ERROR] Could not write the image: %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    if (argc == 4) {
+        long diff = golden_diff(soft_image(&soft), argv[3]);
+        if (diff > 0) {
+            printf("[ERROR] %ld pixels differ from the golden image: %s\n", diff, argv[3]);
+            return EXIT_FAILURE;
+        }
+        printf("[INFO] Same as the golden image: %s\n", argv[3]);
+    }
+    soft_free(&soft);
+    grid_free(&grid);
+    return EXIT_SUCCESS;
+}